@@ -0,0 +1,48 @@
+#version 330
+
+uniform mat4 u_projectionMatrix;
+uniform mat4 u_viewMatrix;
+uniform mat4 u_modelMatrix;
+
+// Drawn through imm as a single texture so it is always on the first unit.
+uniform sampler2D u_textures[8];
+
+[VertProgram]
+
+layout (location = 0) in vec4 i_position;
+layout (location = 1) in vec4 i_color;
+layout (location = 2) in vec2 i_texCoord;
+
+out vec4 v_color;
+out vec2 v_texCoord;
+
+void main()
+{
+    gl_Position = u_projectionMatrix * u_viewMatrix * u_modelMatrix * i_position;
+    v_color = i_color;
+    v_texCoord = i_texCoord;
+}
+
+[FragProgram]
+
+in vec4 v_color;
+in vec2 v_texCoord;
+
+out vec4 o_fragColor;
+
+// Every layer is composited over the base color in a single pass. The layers are side-by-side columns of the
+// texture and their offsets are in texture coordinates, the texture repeats vertically so they wrap around.
+uniform vec4 u_baseColor;
+uniform float u_layerStride;
+uniform float u_layerOffsets[3]; // Must match k_backCount.
+
+void main()
+{
+    o_fragColor = u_baseColor;
+    for(int i=0; i<3; ++i)
+    {
+        vec2 texCoord = vec2(v_texCoord.x + u_layerStride * float(i), v_texCoord.y - u_layerOffsets[i]);
+        vec4 layer = texture(u_textures[0], texCoord) * v_color;
+        o_fragColor = layer + o_fragColor * (1.0 - layer.a); // Premultiplied blend, same as the blend state.
+    }
+}
@@ -1,41 +1,127 @@
 #version 330
 
+// TEXTURED samples the texture units of the vertices, PALETTE additionally resolves palette textures.
+[Keywords] TEXTURED PALETTE
+
 uniform mat4 u_projectionMatrix;
 uniform mat4 u_viewMatrix;
 uniform mat4 u_modelMatrix;
 
-uniform bool u_textureMapping;
-
-uniform sampler2D u_texture0;
+#ifdef TEXTURED
+// Textures are selected per-vertex so that draws using different textures can be batched together, must
+// match imm::k_maxBatchTextures. A vertex's texture units are: the unit to sample, the unit of the palette
+// to resolve the sampled index against (-1 when it isn't a palette texture) and the row of the palette.
+uniform sampler2D u_textures[8];
+#endif
 
 [VertProgram]
 
 layout (location = 0) in vec4 i_position;
 layout (location = 1) in vec4 i_color;
 layout (location = 2) in vec2 i_texCoord;
+layout (location = 3) in vec3 i_texUnits;
 
 out vec4 v_color;
 out vec2 v_texCoord;
+flat out vec3 v_texUnits;
 
 void main()
 {
     gl_Position = u_projectionMatrix * u_viewMatrix * u_modelMatrix * i_position;
     v_color = i_color;
     v_texCoord = i_texCoord;
+    v_texUnits = i_texUnits;
 }
 
 [FragProgram]
 
 in vec4 v_color;
 in vec2 v_texCoord;
+flat in vec3 v_texUnits;
 
 out vec4 o_fragColor;
 
-void main()
+#ifdef TEXTURED
+// Sampler arrays can only be indexed with constant expressions so switch on the unit. Explicit LOD is used
+// as implicit derivatives aren't defined inside of non-uniform control flow (the textures have no mips).
+vec4 SampleUnit(int unit, vec2 texCoord)
 {
-    o_fragColor = v_color;
-    if(u_textureMapping)
+    switch(unit)
     {
-        o_fragColor *= texture(u_texture0, v_texCoord);
+        case 1: return textureLod(u_textures[1], texCoord, 0.0);
+        case 2: return textureLod(u_textures[2], texCoord, 0.0);
+        case 3: return textureLod(u_textures[3], texCoord, 0.0);
+        case 4: return textureLod(u_textures[4], texCoord, 0.0);
+        case 5: return textureLod(u_textures[5], texCoord, 0.0);
+        case 6: return textureLod(u_textures[6], texCoord, 0.0);
+        case 7: return textureLod(u_textures[7], texCoord, 0.0);
     }
+    return textureLod(u_textures[0], texCoord, 0.0);
+}
+#endif
+
+#if defined(TEXTURED) && defined(PALETTE)
+vec4 FetchUnit(int unit, ivec2 texel)
+{
+    switch(unit)
+    {
+        case 1: return texelFetch(u_textures[1], texel, 0);
+        case 2: return texelFetch(u_textures[2], texel, 0);
+        case 3: return texelFetch(u_textures[3], texel, 0);
+        case 4: return texelFetch(u_textures[4], texel, 0);
+        case 5: return texelFetch(u_textures[5], texel, 0);
+        case 6: return texelFetch(u_textures[6], texel, 0);
+        case 7: return texelFetch(u_textures[7], texel, 0);
+    }
+    return texelFetch(u_textures[0], texel, 0);
+}
+
+ivec2 SizeUnit(int unit)
+{
+    switch(unit)
+    {
+        case 1: return textureSize(u_textures[1], 0);
+        case 2: return textureSize(u_textures[2], 0);
+        case 3: return textureSize(u_textures[3], 0);
+        case 4: return textureSize(u_textures[4], 0);
+        case 5: return textureSize(u_textures[5], 0);
+        case 6: return textureSize(u_textures[6], 0);
+        case 7: return textureSize(u_textures[7], 0);
+    }
+    return textureSize(u_textures[0], 0);
+}
+
+// Palette textures are a single channel index texture that gets resolved against a row of a palette.
+vec4 PaletteFetch(int unit, int palette, int row, ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), SizeUnit(unit) - 1);
+    int index = int(FetchUnit(unit, texel).r * 255.0 + 0.5);
+    return FetchUnit(palette, ivec2(index, row));
+}
+
+// Indices can't be blended so we do the bilinear filtering ourselves after looking up the colors.
+vec4 PaletteSample(int unit, int palette, int row, vec2 texCoord)
+{
+    vec2 texel = texCoord * vec2(SizeUnit(unit)) - 0.5;
+    ivec2 i = ivec2(floor(texel));
+    vec2 f = fract(texel);
+    vec4 top = mix(PaletteFetch(unit, palette, row, i), PaletteFetch(unit, palette, row, i + ivec2(1,0)), f.x);
+    vec4 bottom = mix(PaletteFetch(unit, palette, row, i + ivec2(0,1)), PaletteFetch(unit, palette, row, i + ivec2(1,1)), f.x);
+    return mix(top, bottom, f.y);
+}
+#endif
+
+void main()
+{
+    o_fragColor = v_color;
+    #ifdef TEXTURED
+    int unit = int(v_texUnits.x);
+    #ifdef PALETTE
+    int palette = int(v_texUnits.y);
+    if(palette >= 0) o_fragColor *= PaletteSample(unit, palette, int(v_texUnits.z), v_texCoord);
+    else o_fragColor *= SampleUnit(unit, v_texCoord);
+    #else
+    o_fragColor *= SampleUnit(unit, v_texCoord);
+    #endif
+    #endif
 }
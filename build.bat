@@ -14,7 +14,8 @@ echo ----------------------------------------
 if not exist tools mkdir tools
 
 pushd tools
-cl ../source/tools/packer.cpp -I ../depends/nksdk -Fe:packer.exe
+cl ../source/tools/packer.cpp -I ../depends/nksdk -I ../depends/stb -EHsc -Fe:packer.exe
+cl ../source/tools/mathx_bench.cpp -I ../depends/nksdk -EHsc -O2 -std:c++17 -Fe:mathx_bench.exe
 del *.obj
 popd
 
@@ -64,7 +65,7 @@ call depends\emsdk\emsdk_env.bat
 set defs=
 set idir=-I ../../depends/stb -I ../../depends/nksdk
 set libs=-s WASM=1 -s USE_SDL=2 -s USE_SDL_MIXER=2 -s USE_OGG=1 -s USE_VORBIS=1 -s MIN_WEBGL_VERSION=2 -s MAX_WEBGL_VERSION=2 -lidbfs.js
-set cflg=-std=c++17
+set cflg=-std=c++17 -msimd128
 set lflg=-s ALLOW_MEMORY_GROWTH --preload-file ../../assets -s EXPORTED_FUNCTIONS="['_main','_main_start']" -s EXPORTED_RUNTIME_METHODS="['ccall']"
 
 if not exist binary\web mkdir binary\web
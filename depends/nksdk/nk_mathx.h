@@ -9,6 +9,131 @@
 #error nk_mathx requires C++ in order to be used
 #endif
 
+// SIMD ========================================================================
+// The nkVec4 and nkMat4 operations are implemented with SSE, NEON or wasm-simd
+// depending on what the target supports, picked at compile time. Define
+// NK_MATHX_NO_SIMD to force the scalar implementations, which always remain
+// available (nk__*_scalar) as the reference the SIMD paths are checked against.
+#if !defined(NK_MATHX_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define NK_MATHX_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NK_MATHX_NEON
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define NK_MATHX_WASM
+#include <wasm_simd128.h>
+#endif
+#endif
+
+#if defined(NK_MATHX_SSE) || defined(NK_MATHX_NEON) || defined(NK_MATHX_WASM)
+#define NK_MATHX_SIMD
+#endif
+
+#if defined(NK_MATHX_SSE)
+typedef __m128 nk__f32x4;
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_load (const nkF32* p)                 { return _mm_loadu_ps(p);                 }
+NKAPI NKFORCEINLINE void      nk__simd_store(nkF32* p, nk__f32x4 v)          { _mm_storeu_ps(p, v);                    }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_splat(nkF32 f)                        { return _mm_set1_ps(f);                  }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_add  (nk__f32x4 a, nk__f32x4 b)       { return _mm_add_ps(a, b);                }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_sub  (nk__f32x4 a, nk__f32x4 b)       { return _mm_sub_ps(a, b);                }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_mul  (nk__f32x4 a, nk__f32x4 b)       { return _mm_mul_ps(a, b);                }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_div  (nk__f32x4 a, nk__f32x4 b)       { return _mm_div_ps(a, b);                }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_madd (nk__f32x4 a, nk__f32x4 b, nk__f32x4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#elif defined(NK_MATHX_NEON)
+typedef float32x4_t nk__f32x4;
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_load (const nkF32* p)                 { return vld1q_f32(p);                    }
+NKAPI NKFORCEINLINE void      nk__simd_store(nkF32* p, nk__f32x4 v)          { vst1q_f32(p, v);                        }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_splat(nkF32 f)                        { return vdupq_n_f32(f);                  }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_add  (nk__f32x4 a, nk__f32x4 b)       { return vaddq_f32(a, b);                 }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_sub  (nk__f32x4 a, nk__f32x4 b)       { return vsubq_f32(a, b);                 }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_mul  (nk__f32x4 a, nk__f32x4 b)       { return vmulq_f32(a, b);                 }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_madd (nk__f32x4 a, nk__f32x4 b, nk__f32x4 c) { return vaddq_f32(vmulq_f32(a, b), c); }
+#if defined(__aarch64__)
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_div  (nk__f32x4 a, nk__f32x4 b)       { return vdivq_f32(a, b);                 }
+#else
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_div  (nk__f32x4 a, nk__f32x4 b) // 32-bit ARM has no vector divide.
+{
+    nkF32 x[4], y[4];
+    vst1q_f32(x, a);
+    vst1q_f32(y, b);
+    for(nkS32 i=0; i<4; ++i) x[i] /= y[i];
+    return vld1q_f32(x);
+}
+#endif
+#elif defined(NK_MATHX_WASM)
+typedef v128_t nk__f32x4;
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_load (const nkF32* p)                 { return wasm_v128_load(p);               }
+NKAPI NKFORCEINLINE void      nk__simd_store(nkF32* p, nk__f32x4 v)          { wasm_v128_store(p, v);                  }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_splat(nkF32 f)                        { return wasm_f32x4_splat(f);             }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_add  (nk__f32x4 a, nk__f32x4 b)       { return wasm_f32x4_add(a, b);            }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_sub  (nk__f32x4 a, nk__f32x4 b)       { return wasm_f32x4_sub(a, b);            }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_mul  (nk__f32x4 a, nk__f32x4 b)       { return wasm_f32x4_mul(a, b);            }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_div  (nk__f32x4 a, nk__f32x4 b)       { return wasm_f32x4_div(a, b);            }
+NKAPI NKFORCEINLINE nk__f32x4 nk__simd_madd (nk__f32x4 a, nk__f32x4 b, nk__f32x4 c) { return wasm_f32x4_add(wasm_f32x4_mul(a, b), c); }
+#endif
+
+// Column-major 4x4 matrix products on raw floats, the results are allowed to
+// alias the inputs. These get used by the nkMat4 operators further down.
+NKAPI NKFORCEINLINE void nk__m4_mul_scalar(const nkF32* a, const nkF32* b, nkF32* res)
+{
+    nkF32 m[4*4] = NK_ZERO_MEM;
+    for(nkS32 r=0; r<4; ++r)
+        for(nkS32 c1=0; c1<4; ++c1)
+            for(nkS32 c0=0; c0<4; ++c0)
+                m[c1*4+r] += a[c0*4+r] * b[c1*4+c0];
+    for(nkS32 i=0; i<4*4; ++i)
+        res[i] = m[i];
+}
+NKAPI NKFORCEINLINE void nk__m4_mul_v4_scalar(const nkF32* a, const nkF32* b, nkF32* res)
+{
+    nkF32 v[4] = NK_ZERO_MEM;
+    for(nkS32 r=0; r<4; ++r)
+        for(nkS32 c=0; c<4; ++c)
+            v[r] += a[c*4+r] * b[c];
+    for(nkS32 i=0; i<4; ++i)
+        res[i] = v[i];
+}
+
+#if defined(NK_MATHX_SIMD)
+// Each column of the result is a sum of the columns of a weighted by the
+// matching column of b, which maps neatly onto four wide multiply-adds.
+NKAPI NKFORCEINLINE void nk__m4_mul_simd(const nkF32* a, const nkF32* b, nkF32* res)
+{
+    nk__f32x4 a0 = nk__simd_load(a+ 0);
+    nk__f32x4 a1 = nk__simd_load(a+ 4);
+    nk__f32x4 a2 = nk__simd_load(a+ 8);
+    nk__f32x4 a3 = nk__simd_load(a+12);
+    nk__f32x4 m[4];
+    for(nkS32 c=0; c<4; ++c)
+    {
+        const nkF32* bc = b + c*4;
+        nk__f32x4 v = nk__simd_mul(a0, nk__simd_splat(bc[0]));
+        v = nk__simd_madd(a1, nk__simd_splat(bc[1]), v);
+        v = nk__simd_madd(a2, nk__simd_splat(bc[2]), v);
+        v = nk__simd_madd(a3, nk__simd_splat(bc[3]), v);
+        m[c] = v;
+    }
+    for(nkS32 c=0; c<4; ++c)
+        nk__simd_store(res + c*4, m[c]);
+}
+NKAPI NKFORCEINLINE void nk__m4_mul_v4_simd(const nkF32* a, const nkF32* b, nkF32* res)
+{
+    nk__f32x4 v = nk__simd_mul(nk__simd_load(a+0), nk__simd_splat(b[0]));
+    v = nk__simd_madd(nk__simd_load(a+ 4), nk__simd_splat(b[1]), v);
+    v = nk__simd_madd(nk__simd_load(a+ 8), nk__simd_splat(b[2]), v);
+    v = nk__simd_madd(nk__simd_load(a+12), nk__simd_splat(b[3]), v);
+    nk__simd_store(res, v);
+}
+#define NK__M4_MUL    nk__m4_mul_simd
+#define NK__M4_MUL_V4 nk__m4_mul_v4_simd
+#else
+#define NK__M4_MUL    nk__m4_mul_scalar
+#define NK__M4_MUL_V4 nk__m4_mul_v4_scalar
+#endif
+// =============================================================================
+
 static NKCONSTEXPR nkF32 NK_PI  = 3.141592653590f;
 static NKCONSTEXPR nkF32 NK_TAU = 6.283185307180f;
 
@@ -140,6 +265,16 @@ union nkVec4
 
     nkF32 raw[4];
 
+    #if defined(NK_MATHX_SIMD)
+    nkVec4& operator+=(const nkVec4& rhs) { nk__simd_store(raw, nk__simd_add(nk__simd_load(raw), nk__simd_load(rhs.raw))); return *this; }
+    nkVec4& operator-=(const nkVec4& rhs) { nk__simd_store(raw, nk__simd_sub(nk__simd_load(raw), nk__simd_load(rhs.raw))); return *this; }
+    nkVec4& operator/=(const nkVec4& rhs) { nk__simd_store(raw, nk__simd_div(nk__simd_load(raw), nk__simd_load(rhs.raw))); return *this; }
+    nkVec4& operator*=(const nkVec4& rhs) { nk__simd_store(raw, nk__simd_mul(nk__simd_load(raw), nk__simd_load(rhs.raw))); return *this; }
+    nkVec4& operator+=(const nkF32&  rhs) { nk__simd_store(raw, nk__simd_add(nk__simd_load(raw), nk__simd_splat(rhs)));    return *this; }
+    nkVec4& operator-=(const nkF32&  rhs) { nk__simd_store(raw, nk__simd_sub(nk__simd_load(raw), nk__simd_splat(rhs)));    return *this; }
+    nkVec4& operator/=(const nkF32&  rhs) { nk__simd_store(raw, nk__simd_div(nk__simd_load(raw), nk__simd_splat(rhs)));    return *this; }
+    nkVec4& operator*=(const nkF32&  rhs) { nk__simd_store(raw, nk__simd_mul(nk__simd_load(raw), nk__simd_splat(rhs)));    return *this; }
+    #else
     nkVec4& operator+=(const nkVec4& rhs) { x += rhs.x, y += rhs.y, z += rhs.z, w += rhs.w; return *this; }
     nkVec4& operator-=(const nkVec4& rhs) { x -= rhs.x, y -= rhs.y, z -= rhs.z, w -= rhs.w; return *this; }
     nkVec4& operator/=(const nkVec4& rhs) { x /= rhs.x, y /= rhs.y, z /= rhs.z, w /= rhs.w; return *this; }
@@ -148,6 +283,7 @@ union nkVec4
     nkVec4& operator-=(const nkF32&  rhs) { x -= rhs,   y -= rhs,   z -= rhs,   w -= rhs;   return *this; }
     nkVec4& operator/=(const nkF32&  rhs) { x /= rhs,   y /= rhs,   z /= rhs,   w /= rhs;   return *this; }
     nkVec4& operator*=(const nkF32&  rhs) { x *= rhs,   y *= rhs,   z *= rhs,   w *= rhs;   return *this; }
+    #endif
 
     const nkF32& operator[](size_t idx) const { return raw[idx]; }
           nkF32& operator[](size_t idx)       { return raw[idx]; }
@@ -349,12 +485,7 @@ union nkMat4
 
     nkMat4& operator*=(const nkMat4& rhs)
     {
-        nkMat4 m = NK_ZERO_MEM;
-        for(nkS32 r=0; r<4; ++r)
-            for(nkS32 c1=0; c1<4; ++c1)
-                for(nkS32 c0=0; c0<4; ++c0)
-                    m.x[c1][r] += x[c0][r] * rhs.x[c1][c0];
-        *this = m;
+        NK__M4_MUL(raw, rhs.raw, raw);
         return *this;
     }
 };
@@ -374,12 +505,10 @@ NKAPI NKFORCEINLINE nkMat4 operator-(nkMat4 a, const nkMat4& b) { a -= b; return
 NKAPI NKFORCEINLINE nkMat4 operator/(nkMat4 a, const nkMat4& b) { a /= b; return a; }
 NKAPI NKFORCEINLINE nkMat4 operator*(nkMat4 a, const nkMat4& b) { a *= b; return a; }
 
-NKAPI NKFORCEINLINE nkVec4 operator*(nkMat4 a, const nkVec4& b)
+NKAPI NKFORCEINLINE nkVec4 operator*(const nkMat4& a, const nkVec4& b)
 {
-    nkVec4 v = NK_ZERO_MEM;
-    for(nkS32 r=0; r<4; ++r)
-        for(nkS32 c=0; c<4; ++c)
-            v.raw[r] += a.x[c][r] * b.raw[c];
+    nkVec4 v;
+    NK__M4_MUL_V4(a.raw, b.raw, v.raw);
     return v;
 }
 
@@ -397,6 +526,105 @@ NKAPI NKFORCEINLINE nkBool operator!=(const nkMat4& a, const nkMat4& b)
 }
 // =============================================================================
 
+// nkAffine2D ==================================================================
+// A 2D affine transform stored as a 2x3 column-major matrix (the last column is
+// the translation). Much cheaper than going through a full nkMat4 when all you
+// need to do is place some points on a plane (e.g. the corners of a sprite).
+union nkAffine2D
+{
+    struct
+    {
+        nkF32 x00,x01;
+        nkF32 x10,x11;
+        nkF32 x20,x21;
+    };
+
+    nkF32 x[3][2];
+    nkF32 raw[3*2];
+
+    nkAffine2D& operator*=(const nkAffine2D& rhs)
+    {
+        nkAffine2D m;
+        m.x00 = x00 * rhs.x00 + x10 * rhs.x01;
+        m.x01 = x01 * rhs.x00 + x11 * rhs.x01;
+        m.x10 = x00 * rhs.x10 + x10 * rhs.x11;
+        m.x11 = x01 * rhs.x10 + x11 * rhs.x11;
+        m.x20 = x00 * rhs.x20 + x10 * rhs.x21 + x20;
+        m.x21 = x01 * rhs.x20 + x11 * rhs.x21 + x21;
+        *this = m;
+        return *this;
+    }
+};
+
+NKAPI NKFORCEINLINE nkAffine2D nk_a2_identity()
+{
+    nkAffine2D m = NK_ZERO_MEM;
+    m.x00 = 1;
+    m.x11 = 1;
+    return m;
+}
+
+// Builds the transform that scales and rotates points around an origin and then
+// moves that origin to pos, i.e. the same as the following nkMat4 chain but with
+// none of the wasted work:
+//
+//   translate(pos) * scale(scale) * rotate(z, angle) * translate(-origin)
+//
+NKAPI NKFORCEINLINE nkAffine2D nk_a2_trs(const nkVec2& pos, const nkVec2& scale, nkF32 angle, const nkVec2& origin)
+{
+    nkF32 c = 1.0f;
+    nkF32 s = 0.0f;
+    if(angle != 0.0f) // Most things aren't rotated so skip the trig when we can.
+    {
+        c = cosf(angle);
+        s = sinf(angle);
+    }
+
+    nkAffine2D m;
+    m.x00 =  scale.x * c;
+    m.x01 =  scale.y * s;
+    m.x10 = -scale.x * s;
+    m.x11 =  scale.y * c;
+    m.x20 = pos.x - (m.x00 * origin.x + m.x10 * origin.y);
+    m.x21 = pos.y - (m.x01 * origin.x + m.x11 * origin.y);
+    return m;
+}
+
+NKAPI NKFORCEINLINE nkAffine2D operator*(nkAffine2D a, const nkAffine2D& b) { a *= b; return a; }
+
+NKAPI NKFORCEINLINE nkVec2 operator*(const nkAffine2D& a, const nkVec2& b)
+{
+    nkVec2 v;
+    v.x = a.x00 * b.x + a.x10 * b.y + a.x20;
+    v.y = a.x01 * b.x + a.x11 * b.y + a.x21;
+    return v;
+}
+
+// Transforms a batch of points, in and out are allowed to be the same array.
+NKAPI NKFORCEINLINE void nk_a2_transform(const nkAffine2D& m, const nkVec2* in, nkVec2* out, nkS32 count)
+{
+    for(nkS32 i=0; i<count; ++i)
+    {
+        nkF32 px = in[i].x;
+        nkF32 py = in[i].y;
+        out[i].x = m.x00 * px + m.x10 * py + m.x20;
+        out[i].y = m.x01 * px + m.x11 * py + m.x21;
+    }
+}
+
+NKAPI NKFORCEINLINE nkBool operator==(const nkAffine2D& a, const nkAffine2D& b)
+{
+    for(nkS32 i=0; i<3*2; ++i)
+        if(a.raw[i] != b.raw[i])
+            return NK_FALSE;
+    return NK_TRUE;
+}
+NKAPI NKFORCEINLINE nkBool operator!=(const nkAffine2D& a, const nkAffine2D& b)
+{
+    return !(a == b);
+}
+// =============================================================================
+
 NKAPI NKFORCEINLINE nkF32 nk_torad(nkF32 deg)
 {
     return (deg * NK_PI / 180.0f);
@@ -445,7 +673,15 @@ NKAPI NKFORCEINLINE nkVec3 nk_lerp(const nkVec3& a, const nkVec3& b, nkF32 t)
 }
 NKAPI NKFORCEINLINE nkVec4 nk_lerp(const nkVec4& a, const nkVec4& b, nkF32 t)
 {
+    #if defined(NK_MATHX_SIMD)
+    nk__f32x4 va = nk__simd_load(a.raw);
+    nk__f32x4 vb = nk__simd_load(b.raw);
+    nkVec4 v;
+    nk__simd_store(v.raw, nk__simd_madd(nk__simd_sub(vb, va), nk__simd_splat(t), va));
+    return v;
+    #else
     return (a + t * (b - a));
+    #endif
 }
 
 NKAPI NKFORCEINLINE nkF32 nk_length(const nkVec2& v)
@@ -6,6 +6,23 @@ enum AppFlags: u32
     AppFlags_All  = 0xFFFFFFFF
 };
 
+// Set by the app to let the engine know how much is going on, so that it can save power when little is.
+enum PowerMode
+{
+    PowerMode_Active, // Tick and render at the full tick rate.
+    PowerMode_Idle,   // Things are mostly static so tick and render at the idle tick rate.
+    PowerMode_Sleep   // Nothing changes without input so block on events and only tick when woken.
+};
+
+static constexpr u32 k_sleepWaitTime = 250; // Max ms asleep between ticks, so housekeeping still happens.
+
+// Sample frames per audio callback, smaller gets sounds out sooner but risks crackling on slow machines.
+#if defined(__EMSCRIPTEN__)
+static constexpr s32 k_defaultAudioBufferSize = 2048; // Browsers underrun with anything much smaller.
+#else
+static constexpr s32 k_defaultAudioBufferSize = 512;
+#endif // __EMSCRIPTEN__
+
 struct WindowConfig
 {
     nkVec2 size = { 1280,720 };
@@ -19,10 +36,16 @@ struct AppConfig
 {
     std::string title = "Unnamed";
     f32 tickrate = 60.0f;
+    f32 idleTickrate = 20.0f;
     nkVec4 clearColor = { 0,0,0,1 };
     WindowConfig window = WindowConfig();
     nkVec2 screenSize = { 1280,720 };
     AppFlags flags = AppFlags_None;
+    size_t assetBudget = 0; // Bytes of assets to keep loaded at once (see SetAssetBudget), 0 is unlimited.
+    s32 audioBufferSize = k_defaultAudioBufferSize;
+    std::string audioRecordFile; // Records the audio calls made to this session file (see audio_render).
+    std::string audioRenderSession; // Renders this recorded session to audioRenderOutput and exits, without a window.
+    std::string audioRenderOutput;
     Application* app = NULL;
 };
 
@@ -36,6 +59,7 @@ public:
     virtual ~Application() {}
 
     bool m_running = false;
+    PowerMode m_powerMode = PowerMode_Active;
 };
 
 // Predeclare the AppMain function so we can call it from platform.
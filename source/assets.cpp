@@ -1,50 +1,229 @@
 static void InitAssetManager()
 {
-    // Attempt to load the NPAK, if not then it doesn't matter.
-    #if !defined(__EMSCRIPTEN__)
-    std::string npakFilePath = GetExecPath() + "assets.npak";
-    if(nk_npak_load(&s_assetManager.npak, npakFilePath.c_str()))
+    InitVfs();
+    SetAssetBudget(GetAppConfig().assetBudget);
+}
+
+static void QuitAssetManager()
+{
+    #if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__) && defined(__linux__)
+    if(s_assetManager.watcher.inotify != -1)
+    {
+        close(s_assetManager.watcher.inotify);
+        s_assetManager.watcher.inotify = -1;
+    }
+    #endif
+
+    for(auto& [name,asset]: s_assetManager.assetMap)
+    {
+        if(asset)
+        {
+            if(!asset->m_evicted) asset->Free(); // Evicted assets have already been freed.
+            Deallocate(asset);
+        }
+    }
+    s_assetManager.assetMap.clear();
+    s_assetManager.assetHashMap.clear();
+
+    QuitVfs();
+}
+
+//
+// Residency
+//
+
+static void TrackAssetLoaded(AssetBase* asset)
+{
+    asset->m_residentBytes = asset->GetResidentBytes();
+    s_assetManager.residentBytes += asset->m_residentBytes;
+
+    AssetMemoryStats& stats = s_assetManager.memoryStats[asset->GetType()];
+    stats.loaded++;
+    stats.residentBytes += asset->m_residentBytes;
+    stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes);
+}
+
+static void TrackAssetUnloaded(AssetBase* asset)
+{
+    s_assetManager.residentBytes -= asset->m_residentBytes;
+
+    AssetMemoryStats& stats = s_assetManager.memoryStats[asset->GetType()];
+    stats.loaded--;
+    stats.residentBytes -= asset->m_residentBytes;
+
+    asset->m_residentBytes = 0;
+}
+
+static void EvictAsset(AssetBase* asset)
+{
+    printf("Evicting %s: %s\n", asset->GetType(), asset->m_name.c_str());
+
+    TrackAssetUnloaded(asset);
+    s_assetManager.memoryStats[asset->GetType()].evicted++;
+
+    asset->Free();
+    asset->m_loaded = false;
+    asset->m_evicted = true;
+}
+
+// Evicts the least recently used assets until we're back under the budget. Assets that are referenced, in use,
+// or were touched during the last frame (which is still being presented and may be used again) are left alone.
+static void EvictAssets()
+{
+    if(!s_assetManager.budget || s_assetManager.residentBytes <= s_assetManager.budget) return;
+
+    static std::vector<AssetBase*> s_candidates; // Kept around so we don't allocate every frame whilst over budget.
+    s_candidates.clear();
+    for(auto* asset: s_assetManager.assetList)
+    {
+        if(!asset->m_loaded || asset->m_refs || !asset->m_residentBytes) continue;
+        if(asset->m_lastUsed + 1 >= s_assetManager.frame || asset->IsInUse()) continue;
+        s_candidates.push_back(asset);
+    }
+    std::sort(s_candidates.begin(), s_candidates.end(), [](AssetBase* a, AssetBase* b) { return (a->m_lastUsed < b->m_lastUsed); });
+
+    for(auto* asset: s_candidates)
+    {
+        if(s_assetManager.residentBytes <= s_assetManager.budget) break;
+        EvictAsset(asset);
+    }
+}
+
+static void SetAssetBudget(size_t bytes)
+{
+    s_assetManager.budget = bytes;
+}
+
+static size_t GetAssetBudget()
+{
+    return s_assetManager.budget;
+}
+
+static size_t GetAssetResidentBytes()
+{
+    return s_assetManager.residentBytes;
+}
+
+static const std::map<std::string,AssetMemoryStats>& GetAssetMemoryStats()
+{
+    return s_assetManager.memoryStats;
+}
+
+static void PrintAssetMemoryStats()
+{
+    printf("Asset Memory (%zu bytes resident, %zu bytes budget):\n", s_assetManager.residentBytes, s_assetManager.budget);
+    for(auto& [type,stats]: s_assetManager.memoryStats)
     {
-        printf("Successfully loaded NPAK assets!\n");
-        s_assetManager.npakLoaded = true;
+        printf("  %-16s loaded: %-6zu resident: %-10zu peak: %-10zu evicted: %zu\n", type.c_str(),
+            stats.loaded, stats.residentBytes, stats.peakBytes, stats.evicted);
     }
-    #endif // __EMSCRIPTEN__
+}
 
-    // The executable's location is the highest priority location for assets.
-    s_assetManager.assetPaths.push_back(GetExecPath());
-    s_assetManager.assetPaths.push_back(GetExecPath() + "assets/");
+//
+// Hot Reload
+//
 
-    // If there's other asset locations add them with descending priority.
-    std::ifstream file("asset_paths.txt", std::ios::in);
-    if(file.is_open())
+#if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__)
+static void WatchAsset(AssetBase* asset)
+{
+    AssetWatcher& watcher = s_assetManager.watcher;
+
+    // Assets that only exist in the NPAK have nothing on disk for us to watch.
+    if(!DoesFileExist(asset->m_fileName)) return;
+
+    #if defined(__linux__)
+    if(watcher.inotify == -1)
     {
-        std::string path;
-        while(std::getline(file, path))
+        watcher.inotify = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if(watcher.inotify == -1)
         {
-            s_assetManager.assetPaths.push_back(GetExecPath() + ValidatePath(path));
+            printf("Failed to initialize inotify, asset hot reloading is disabled!\n");
+            return;
         }
     }
+    // Watches are per-directory, adding the same directory twice just returns the existing watch.
+    std::string pathName = GetFilePath(asset->m_fileName);
+    int watch = inotify_add_watch(watcher.inotify, pathName.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO);
+    if(watch != -1) watcher.watches[watch] = pathName;
+    #else
+    std::error_code error;
+    auto writeTime = std::filesystem::last_write_time(asset->m_fileName, error);
+    if(!error) watcher.writeTimes[asset->m_fileName] = writeTime;
+    #endif
 }
 
-static void QuitAssetManager()
+static void ReloadAssetFile(const std::string& fileName)
 {
-    for(auto& [name,asset]: s_assetManager.assetMap)
+    for(auto* asset: s_assetManager.assetList)
     {
-        if(asset)
+        if(asset->m_loaded && asset->m_fileName == fileName)
         {
-            asset->Free();
-            Deallocate(asset);
+            printf("Reloading %s: %s\n", asset->GetType(), asset->m_name.c_str());
+            TrackAssetUnloaded(asset);
+            if(!asset->ReloadFromFile(fileName))
+                printf("Failed to reload %s: %s (keeping the previous version)\n", asset->GetType(), asset->m_name.c_str());
+            TrackAssetLoaded(asset);
         }
     }
-    s_assetManager.assetMap.clear();
+}
+#endif
 
-    // We need to free the NPAK if we did end up loading it.
-    #if !defined(__EMSCRIPTEN__)
-    if(s_assetManager.npakLoaded)
+static void BeginAssetFrame()
+{
+    // Only rendered frames count, iterations that just tick or idle don't age the assets the last frame used.
+    s_assetManager.frame++;
+    EvictAssets();
+}
+
+static void UpdateAssetManager()
+{
+    #if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__)
+    AssetWatcher& watcher = s_assetManager.watcher;
+
+    std::vector<std::string> changedFiles;
+
+    #if defined(__linux__)
+    if(watcher.inotify == -1) return;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while((length = read(watcher.inotify, buffer, sizeof(buffer))) > 0)
     {
-        nk_npak_free(&s_assetManager.npak);
+        const inotify_event* event;
+        for(char* ptr=buffer; ptr<buffer+length; ptr+=sizeof(inotify_event)+event->len)
+        {
+            event = NK_CAST(const inotify_event*, ptr);
+            if(!event->len) continue;
+            auto watch = watcher.watches.find(event->wd);
+            if(watch != watcher.watches.end())
+                changedFiles.push_back(watch->second + event->name);
+        }
+    }
+    #else
+    // Only poll a couple of times a second, stat-ing every asset each frame is wasteful.
+    static constexpr u32 k_pollInterval = 500;
+    u32 ticks = SDL_GetTicks();
+    if(ticks - watcher.lastPoll < k_pollInterval) return;
+    watcher.lastPoll = ticks;
+
+    for(auto& [fileName,writeTime]: watcher.writeTimes)
+    {
+        std::error_code error;
+        auto newWriteTime = std::filesystem::last_write_time(fileName, error);
+        if(!error && newWriteTime != writeTime)
+        {
+            writeTime = newWriteTime;
+            changedFiles.push_back(fileName);
+        }
     }
-    #endif // __EMSCRIPTEN__
+    #endif
+
+    // Editors can generate multiple events for a single save so only reload each file once.
+    std::sort(changedFiles.begin(), changedFiles.end());
+    changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+    for(auto& fileName: changedFiles)
+        ReloadAssetFile(fileName);
+    #endif
 }
 
 //
@@ -59,14 +238,8 @@ static std::string GetAssetPath(std::string name)
 
     AssetType dummy;
 
-    std::string lookup = name + dummy.GetExt();
-    std::string fileName;
-    for(auto& assetPath: s_assetManager.assetPaths)
-    {
-        fileName = ValidatePath(assetPath + dummy.GetPath()) + lookup;
-        if(DoesFileExist(fileName)) break;
-    }
-    return fileName;
+    const VfsEntry* entry = FindVfsFile(dummy.GetPath() + name + dummy.GetExt());
+    return ((entry) ? entry->fileName : "");
 }
 
 template<typename T>
@@ -84,39 +257,49 @@ static bool LoadAsset(std::string name)
     if(asset && asset->m_loaded) return true;
 
     // Load the asset if we need to.
-    printf("Loading %s: %s\n", dummy.GetType(), name.c_str());
+    printf("%s %s: %s\n", (asset && asset->m_evicted) ? "Reloading" : "Loading", dummy.GetType(), name.c_str());
 
     if(!asset) asset = Allocate<AssetType>(MEM_ASSET);
     if(!asset) return false;
 
     asset->m_name = ValidatePath(name);
     asset->m_lookup = lookup;
-    asset->m_fileName = GetAssetPath<T>(asset->m_name);
 
     // First look in the NPAK and then fallback to looking on disk.
-    #if !defined(__EMSCRIPTEN__)
-    if(s_assetManager.npakLoaded)
+    const VfsEntry* entry = FindVfsFile(dummy.GetPath() + lookup);
+    if(entry)
     {
-        std::string npakName = dummy.GetPath() + lookup;
-        nkU64 fileSize;
-        void* fileData = nk_npak_get_file_data(&s_assetManager.npak, npakName.c_str(), &fileSize);
-        if(fileData)
+        asset->m_fileName = entry->fileName;
+        if(entry->inNpak)
         {
-            asset->m_loaded = asset->LoadFromData(fileData, fileSize);
+            asset->m_loaded = asset->LoadFromStream(*entry);
+            VfsFile file;
+            if(!asset->m_loaded && ReadVfsFile(*entry, file))
+                asset->m_loaded = asset->LoadFromData(file.buffer.data(), file.size);
         }
+        if(!asset->m_loaded && !entry->fileName.empty())
+            asset->m_loaded = asset->LoadFromFile(entry->fileName);
     }
-    #endif // __EMSCRIPTEN__
-    if(!asset->m_loaded)
+    else
     {
-        asset->m_loaded = asset->LoadFromFile(asset->m_fileName);
+        printf("Failed to find %s: %s\n", dummy.GetType(), name.c_str());
     }
 
+    asset->m_evicted = false;
+    asset->m_lastUsed = s_assetManager.frame;
+    if(asset->m_loaded) TrackAssetLoaded(asset);
+
     // Add it to the asset containers.
     s_assetManager.assetMap[lookup] = asset;
+    s_assetManager.assetHashMap[HashAssetName(lookup.c_str())] = asset;
     auto loc = std::find(s_assetManager.assetList.begin(), s_assetManager.assetList.end(), asset);
     if(loc != s_assetManager.assetList.end()) s_assetManager.assetList.erase(loc);
     s_assetManager.assetList.push_back(asset);
 
+    #if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__)
+    if(asset->m_loaded) WatchAsset(asset);
+    #endif
+
     // If the type is new add it to the debug UI filters.
     if(!Contains(s_assetManager.assetFilters, std::string(asset->GetType())))
     {
@@ -144,30 +327,104 @@ static T* GetAsset(std::string name)
         asset = dynamic_cast<AssetType*>(s_assetManager.assetMap[lookup]);
         if(!asset) return NULL;
     }
+    else if(asset->m_evicted)
+    {
+        LoadAsset<T>(name);
+    }
+    asset->m_lastUsed = s_assetManager.frame;
     return ((asset->m_loaded) ? &asset->m_data : NULL);
 }
 
 template<typename T>
-static void LoadAllAssetsOfType()
+static T* GetAsset(AssetHandle<T>& handle)
 {
     typedef Asset<T> AssetType;
-    AssetType dummy;
 
-    std::vector<std::string> files;
-    for(auto& assetPath: s_assetManager.assetPaths)
+    // Resolve the handle the first time it is used, after that it is just a pointer read.
+    if(!handle.m_asset)
     {
-        std::string pathName = ValidatePath(assetPath + dummy.GetPath());
-        ListPathFiles(pathName, files, true);
-        for(auto& file: files) // Load all the valid asset files in the path.
+        if(!handle.m_name) return NULL;
+
+        AssetType dummy;
+
+        u32 hash = HashAssetName(dummy.GetExt(), handle.m_hash);
+        auto it = s_assetManager.assetHashMap.find(hash);
+        if(it == s_assetManager.assetHashMap.end())
         {
-            if(GetFileExtension(file) == dummy.GetExt())
-            {
-                std::string name = StripFileExtension(file);
-                name.erase(0, pathName.length());
-                LoadAsset<T>(name);
-            }
+            if(!LoadAsset<T>(handle.m_name)) return NULL;
+            it = s_assetManager.assetHashMap.find(hash);
+            if(it == s_assetManager.assetHashMap.end()) return NULL;
         }
-        files.clear();
+
+        handle.m_asset = dynamic_cast<AssetType*>(it->second);
+        if(!handle.m_asset) return NULL;
+        ASSERT(handle.m_asset->m_name == handle.m_name, "Asset name hash collision!");
+    }
+    if(handle.m_asset->m_evicted)
+    {
+        LoadAsset<T>(handle.m_name);
+    }
+    handle.m_asset->m_lastUsed = s_assetManager.frame;
+    return ((handle.m_asset->m_loaded) ? &handle.m_asset->m_data : NULL);
+}
+
+// The reference is taken even if the asset failed to load, so every acquire can be paired with a release.
+template<typename T>
+static T* AcquireAsset(std::string name)
+{
+    typedef Asset<T> AssetType;
+    T* data = GetAsset<T>(name);
+
+    AssetType dummy;
+
+    auto it = s_assetManager.assetMap.find(ValidatePath(name) + dummy.GetExt());
+    if(it != s_assetManager.assetMap.end() && it->second) it->second->m_refs++;
+    return data;
+}
+
+template<typename T>
+static T* AcquireAsset(AssetHandle<T>& handle)
+{
+    T* data = GetAsset(handle);
+    if(handle.m_asset) handle.m_asset->m_refs++;
+    return data;
+}
+
+template<typename T>
+static void ReleaseAsset(std::string name)
+{
+    typedef Asset<T> AssetType;
+    AssetType dummy;
+
+    auto it = s_assetManager.assetMap.find(ValidatePath(name) + dummy.GetExt());
+    if(it == s_assetManager.assetMap.end() || !it->second) return;
+    ASSERT(it->second->m_refs > 0, "Asset released more times than it was acquired!");
+    it->second->m_refs--;
+}
+
+template<typename T>
+static void ReleaseAsset(AssetHandle<T>& handle)
+{
+    if(!handle.m_asset) return;
+    ASSERT(handle.m_asset->m_refs > 0, "Asset released more times than it was acquired!");
+    handle.m_asset->m_refs--;
+}
+
+template<typename T>
+static void LoadAllAssetsOfType()
+{
+    typedef Asset<T> AssetType;
+    AssetType dummy;
+
+    std::string pathName = dummy.GetPath();
+    std::string extName = dummy.GetExt();
+
+    std::vector<const VfsEntry*> files;
+    ListVfsFiles(pathName, extName, files);
+    for(auto* file: files) // Load all the valid asset files in the path.
+    {
+        std::string name = file->name.substr(pathName.length(), file->name.length() - pathName.length() - extName.length());
+        LoadAsset<T>(name);
     }
 }
 
@@ -177,24 +434,18 @@ static std::vector<T*> GetAllAssetsOfType()
     typedef Asset<T> AssetType;
     AssetType dummy;
 
-    std::vector<std::string> files;
+    std::string pathName = dummy.GetPath();
+    std::string extName = dummy.GetExt();
+
+    std::vector<const VfsEntry*> files;
     std::vector<T*> assets;
 
-    for(auto& assetPath: s_assetManager.assetPaths)
+    ListVfsFiles(pathName, extName, files);
+    for(auto* file: files) // Get all the valid asset files in the path.
     {
-        std::string pathName = ValidatePath(assetPath + dummy.GetPath());
-        ListPathFiles(pathName, files, true);
-        for(auto& file: files) // Get all the valid asset files in the path.
-        {
-            if(GetFileExtension(file) == dummy.GetExt())
-            {
-                std::string name = StripFileExtension(file);
-                name.erase(0, pathName.length());
-                T* asset = GetAsset<T>(name);
-                if(asset) assets.push_back(asset);
-            }
-        }
-        files.clear();
+        std::string name = file->name.substr(pathName.length(), file->name.length() - pathName.length() - extName.length());
+        T* asset = GetAsset<T>(name);
+        if(asset) assets.push_back(asset);
     }
 
     return assets;
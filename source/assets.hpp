@@ -1,3 +1,5 @@
+struct VfsEntry;
+
 #define DECLARE_ASSET(type) template<> class Asset<type>: public AssetBase
 
 // Base asset type, all assets should be specializations of Asset<T>.
@@ -6,16 +8,24 @@ class AssetBase
 public:
     virtual bool        LoadFromFile(std::string fileName) = 0;
     virtual bool        LoadFromData(void* data, size_t bytes) = 0;
+    virtual bool        LoadFromStream(const VfsEntry&) { return false; } // Assets that decode as they go can stream from the NPAK instead of having it read into memory.
+    virtual bool        ReloadFromFile(std::string) { return false; } // Reloads in-place, keeping the same handle.
     virtual void        Free() = 0;
     virtual const char* GetPath() const = 0;
     virtual const char* GetExt() const = 0;
     virtual const char* GetType() const = 0;
+    virtual size_t      GetResidentBytes() const { return 0; } // Memory the loaded asset costs, assets that cost nothing are never evicted.
+    virtual bool        IsInUse() const { return false; } // E.g. a sound that is still playing, these can't be evicted.
 
     // For internal use.
     std::string m_name;
     std::string m_lookup;
     std::string m_fileName;
     bool        m_loaded = false;
+    bool        m_evicted = false; // Unloaded to stay under the budget, gets reloaded the next time it is used.
+    u32         m_refs = 0;
+    u64         m_lastUsed = 0; // Frame the asset was last accessed on, for picking the least recently used.
+    size_t      m_residentBytes = 0;
 };
 template<typename T>
 class Asset: public AssetBase
@@ -23,21 +33,84 @@ class Asset: public AssetBase
     // Nothing...
 };
 
+// FNV-1a hash of an asset name. The seed allows continuing a hash, e.g. hashing an extension onto a name.
+static constexpr u32 k_assetHashSeed = 2166136261u;
+static constexpr u32 HashAssetName(const char* str, u32 hash = k_assetHashSeed)
+{
+    while(*str) hash = (hash ^ NK_CAST(u8, *str++)) * 16777619u;
+    return hash;
+}
+
+// A typed reference to an asset that is resolved on first use and then accessed directly, which avoids
+// the string building and map lookups of GetAsset<T>(name). The name is hashed at compile time and must
+// outlive the handle, so handles should be created from string literals.
+template<typename T>
+class AssetHandle
+{
+public:
+    constexpr AssetHandle(): m_name(NULL), m_hash(0), m_asset(NULL) {}
+    constexpr explicit AssetHandle(const char* name): m_name(name), m_hash(HashAssetName(name)), m_asset(NULL) {}
+
+    const char* m_name;
+    u32         m_hash;
+    Asset<T>*   m_asset;
+};
+
+#if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__)
+// Watches the files of loaded assets so they can be hot reloaded whilst the game is running. On Linux
+// we get notified of changes through inotify, everywhere else we fallback to polling file write times.
+struct AssetWatcher
+{
+    #if defined(__linux__)
+    int                                                   inotify = -1;
+    std::map<int,std::string>                             watches; // Watch descriptor -> directory.
+    #else
+    std::map<std::string,std::filesystem::file_time_type> writeTimes;
+    u32                                                   lastPoll = 0;
+    #endif
+};
+#endif
+
+// What the loaded assets of a type cost. What the bytes are depends on the type, e.g. textures count the VRAM
+// used, sounds count their decoded PCM and music counts its compressed data.
+struct AssetMemoryStats
+{
+    size_t loaded;
+    size_t evicted;
+    size_t residentBytes;
+    size_t peakBytes;
+};
+
 struct AssetManager
 {;
-    nkNPAK npak;
-    bool   npakLoaded;
+    size_t budget; // Max bytes of loaded assets before the least recently used unreferenced ones get evicted, 0 is unlimited.
+    size_t residentBytes;
+    u64    frame;
+
+    std::map<std::string,AssetMemoryStats> memoryStats; // Keyed by asset type.
 
     std::map<std::string,bool>       assetFilters;
     std::map<std::string,AssetBase*> assetMap;
+    std::unordered_map<u32,AssetBase*> assetHashMap; // Keyed by HashAssetName of the lookup.
     std::vector<AssetBase*>          assetList;
-    std::vector<std::string>         assetPaths;
+
+    #if defined(BUILD_DEBUG) && !defined(__EMSCRIPTEN__)
+    AssetWatcher watcher;
+    #endif
 };
 
 static AssetManager s_assetManager;
 
 static void InitAssetManager();
 static void QuitAssetManager();
+static void UpdateAssetManager(); // Hot reloads any assets that have changed on disk (debug only).
+static void BeginAssetFrame(); // Called when a frame is rendered, evicts assets to stay under the budget.
+
+static void   SetAssetBudget(size_t bytes); // 0 is unlimited.
+static size_t GetAssetBudget();
+static size_t GetAssetResidentBytes();
+static const std::map<std::string,AssetMemoryStats>& GetAssetMemoryStats();
+static void   PrintAssetMemoryStats();
 
 //
 // Asset Interface
@@ -50,6 +123,19 @@ static bool LoadAsset(std::string name);
 template<typename T>
 static T* GetAsset(std::string name);
 template<typename T>
+static T* GetAsset(AssetHandle<T>& handle);
+// Referenced assets are kept loaded regardless of the budget, anything else can be evicted once it hasn't been
+// used for a couple of frames and is reloaded on demand the next time it is got. Pointers to the asset data
+// should not be held across frames unless the asset has been acquired. Every acquire must be released.
+template<typename T>
+static T* AcquireAsset(std::string name);
+template<typename T>
+static T* AcquireAsset(AssetHandle<T>& handle);
+template<typename T>
+static void ReleaseAsset(std::string name);
+template<typename T>
+static void ReleaseAsset(AssetHandle<T>& handle);
+template<typename T>
 static void LoadAllAssetsOfType();
 template<typename T>
 static std::vector<T*> GetAllAssetsOfType();
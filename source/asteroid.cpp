@@ -1,5 +1,13 @@
+static void CreateAsteroids()
+{
+    s_asteroids.reserve(k_maxAsteroids);
+}
+
 static void SpawnAsteroid()
 {
+    // Never grow past what was reserved so spawning doesn't have to touch the heap.
+    if(s_asteroids.size() >= k_maxAsteroids) return;
+
     Asteroid asteroid = {};
     asteroid.pos = { RandomF32(0, GetScreenWidth()), -48.0f };
     asteroid.dead = false;
@@ -34,7 +42,7 @@ static void UpdateAsteroids(f32 dt)
 
 static void RenderAsteroids(f32 dt)
 {
-    imm::BeginTextureBatch("asteroid");
+    imm::BeginTextureBatch(s_asteroidTexture);
     for(auto& asteroid: s_asteroids)
     {
         Rect clip = { NK_CAST(f32, 48*asteroid.type), 0, 48, 48 };
@@ -24,14 +24,18 @@ static constexpr f32 k_asteroidFallSpeed = 400.0f;
 static constexpr f32 k_entitySpawnCooldownTime = 2.0f;
 static constexpr f32 k_difficultyIncreaseInterval = 5.0f;
 static constexpr s32 k_maxDifficulty = 75;
+static constexpr s32 k_maxAsteroids = 256;
 
 static std::vector<Asteroid> s_asteroids;
 
+static AssetHandle<Texture> s_asteroidTexture("asteroid");
+
 static f32 s_entitySpawnCooldown;
 static f32 s_entitySpawnTimer;
 static f32 s_difficultyTimer;
 static s32 s_difficulty;
 
+static void CreateAsteroids();
 static void SpawnAsteroid();
 static void UpdateAsteroids(f32 dt);
 static void RenderAsteroids(f32 dt);
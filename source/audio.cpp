@@ -1,52 +1,405 @@
 DEFINE_PRIVATE_STRUCT(Sound)
 {
     Mix_Chunk* chunk;
+    std::vector<u8> cached; // Cache file the chunk's samples point into if it was loaded from the sound cache.
+    std::atomic<u32> voices { 0 }; // Voices playing (or queued to play) the sound, so it's not freed out from under the mixer.
+    u64 lastPlayedTick = 0; // For dropping duplicates within a tick.
 };
 
+// Music is decoded as it plays so it needs its source for as long as it is open. To keep only the current
+// track costing memory the music is only opened whilst it is current, otherwise we just hold onto where to
+// open it from: a stream from the VFS (i.e. the NPAK), a file on disk, or a copy of the data it was loaded from.
 DEFINE_PRIVATE_STRUCT(Music)
 {
-    Mix_Music* music;
+    Mix_Music* music = NULL;
+    const VfsEntry* entry = NULL;
+    std::string fileName;
+    std::vector<u8> data;
+    Mix_Chunk* chunk = NULL; // Offline there's no SDL_mixer music playback, so the whole track is decoded whilst open.
 };
 
 static constexpr s32 k_mixerFrequency = MIX_DEFAULT_FREQUENCY;
-static constexpr u16 k_mixerSampleFormat = MIX_DEFAULT_FORMAT;
+static constexpr u16 k_mixerSampleFormat = AUDIO_S16SYS; // The sound mixer only deals with 16-bit samples.
 static constexpr s32 k_mixerChannels = 2; // Stereo Sound
-static constexpr s32 k_mixerSampleSize = 2048;
+static constexpr s32 k_mixerVoices = 32;
+static constexpr u32 k_mixerCommandCapacity = 256; // Must be a power of two.
+static constexpr s32 k_mixerBlockSize = 256; // Samples mixed at a time, the callback may ask for more or less.
+
+// Decoding the OGGs is most of the cost of loading sounds, so the decoded samples get cached on disk, keyed by a
+// hash of the source data and the format the device was opened with (what Mix_LoadWAV converts to), and loading
+// a sound we've seen before is then just reading the file. There's one file per sound, so when the source or the
+// format changes the new samples replace the stale ones. The web build has nowhere persistent to put them.
+static constexpr u32 k_soundCacheMagic = 0x4D435053; // 'SPCM'
+static constexpr u32 k_soundCacheVersion = 1;
+
+struct SoundCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u64 sourceHash;
+    u64 sourceSize;
+    s32 frequency;
+    u16 format;
+    u16 channels;
+    u32 bytes; // Of samples, following the header.
+    u32 padding;
+};
 
 struct AudioContext
 {
     f32 soundVolume;
     f32 musicVolume;
+    Music currentMusic;
+    std::string currentMusicAsset; // Name of the acquired music asset, if the current music was played by name.
+    u64 tick;
 };
 
 static AudioContext s_audioContext;
 
-static void InitAudio()
+// Sound effects are mixed by us rather than SDL_mixer, on top of its music output, from its post-mix callback.
+// The game thread never touches the mixer's state, instead it pushes commands onto a lock-free queue that the
+// callback drains at the start of every buffer, so playing a sound never has to wait on the audio lock.
+enum MixerCommandType
+{
+    MixerCommand_Play,
+    MixerCommand_Stop,      // Stops a single voice.
+    MixerCommand_StopSound, // Stops every voice playing a sound.
+    MixerCommand_Volume
+};
+
+struct MixerCommand
+{
+    MixerCommandType type;
+    SoundRef ref;
+    Sound sound;
+    s32 loops;
+    SoundPriority priority;
+    s32 maxInstances;
+    f32 volume;
+};
+
+// Single producer (the game thread) and single consumer (the audio callback).
+struct MixerCommandQueue
+{
+    MixerCommand commands[k_mixerCommandCapacity];
+    std::atomic<u32> head { 0 }; // Next command to pop, only written by the consumer.
+    std::atomic<u32> tail { 0 }; // Next slot to push, only written by the producer.
+};
+
+struct MixerVoice
+{
+    Sound sound;
+    Mix_Chunk* chunk;
+    SoundRef ref;
+    u32 position; // In samples, not frames.
+    s32 loops; // Remaining, -1 loops forever.
+    SoundPriority priority;
+    u32 started; // Order the voices were started in, for finding the oldest.
+};
+
+struct Mixer
+{
+    MixerCommandQueue queue;
+    bool open; // Whether the callback is installed (or we're offline), once it isn't nothing drains the queue.
+    bool offline; // Rendering without a real device (see audio_render), so the game thread drives the callback.
+    SoundRef nextRef; // Game thread only.
+    u64 deduped; // Game thread only.
+
+    // Audio thread only.
+    MixerVoice voices[k_mixerVoices];
+    s32 voiceCount;
+    u32 voiceSerial;
+    f32 volume;
+
+    // Offline only, as otherwise SDL_mixer plays the music. With no audio thread the game thread sets these directly.
+    MixerVoice music;
+    bool musicPaused;
+    f32 musicVolume;
+
+    // Written by the audio thread, read by the game thread for stats.
+    std::atomic<u32> activeVoices { 0 };
+    std::atomic<u32> peakVoices { 0 };
+    std::atomic<u64> played { 0 };
+    std::atomic<u64> dropped { 0 };
+    std::atomic<u64> stolen { 0 };
+};
+
+static Mixer s_mixer;
+
+static bool PushMixerCommand(const MixerCommand& command)
+{
+    MixerCommandQueue& queue = s_mixer.queue;
+    u32 tail = queue.tail.load(std::memory_order_relaxed);
+    if(tail - queue.head.load(std::memory_order_acquire) >= k_mixerCommandCapacity)
+        return false;
+    queue.commands[tail & (k_mixerCommandCapacity-1)] = command;
+    queue.tail.store(tail+1, std::memory_order_release);
+    return true;
+}
+
+static bool PopMixerCommand(MixerCommand& command)
+{
+    MixerCommandQueue& queue = s_mixer.queue;
+    u32 head = queue.head.load(std::memory_order_relaxed);
+    if(head == queue.tail.load(std::memory_order_acquire))
+        return false;
+    command = queue.commands[head & (k_mixerCommandCapacity-1)];
+    queue.head.store(head+1, std::memory_order_release);
+    return true;
+}
+
+static void RemoveMixerVoice(s32 index)
+{
+    s_mixer.voices[index].sound->voices.fetch_sub(1, std::memory_order_release);
+    s_mixer.voices[index] = s_mixer.voices[--s_mixer.voiceCount];
+}
+
+static bool IsMixerVoiceStealable(const MixerVoice& voice)
+{
+    return (voice.loops >= 0 && voice.priority < SoundPriority_Critical);
+}
+
+static void StartMixerVoice(const MixerCommand& command)
+{
+    s32 instances = 0, oldest = -1, weakest = -1;
+    for(s32 i=0; i<s_mixer.voiceCount; ++i)
+    {
+        const MixerVoice& voice = s_mixer.voices[i];
+        bool stealable = IsMixerVoiceStealable(voice);
+        if(voice.sound == command.sound)
+        {
+            instances++;
+            if(stealable && (oldest == -1 || voice.started < s_mixer.voices[oldest].started))
+                oldest = i;
+        }
+        if(stealable && (weakest == -1 || voice.priority < s_mixer.voices[weakest].priority ||
+           (voice.priority == s_mixer.voices[weakest].priority && voice.started < s_mixer.voices[weakest].started)))
+        {
+            weakest = i;
+        }
+    }
+
+    // Over the sound's limit we replace its oldest instance, out of voices we replace the weakest one.
+    bool full = false;
+    s32 steal = -1;
+    if(command.maxInstances > 0 && instances >= command.maxInstances)
+    {
+        full = true;
+        steal = oldest;
+    }
+    else if(s_mixer.voiceCount >= k_mixerVoices)
+    {
+        full = true;
+        if(weakest != -1 && s_mixer.voices[weakest].priority <= command.priority)
+            steal = weakest;
+    }
+
+    if(full)
+    {
+        if(steal == -1)
+        {
+            command.sound->voices.fetch_sub(1, std::memory_order_release);
+            s_mixer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        RemoveMixerVoice(steal);
+        s_mixer.stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    s_mixer.voices[s_mixer.voiceCount++] = { command.sound, command.sound->chunk, command.ref, 0, command.loops, command.priority, s_mixer.voiceSerial++ };
+    s_mixer.played.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ProcessMixerCommands()
+{
+    MixerCommand command;
+    while(PopMixerCommand(command))
+    {
+        switch(command.type)
+        {
+            case MixerCommand_Play:
+            {
+                StartMixerVoice(command);
+            } break;
+            case MixerCommand_Stop:
+            {
+                for(s32 i=0; i<s_mixer.voiceCount; ++i)
+                {
+                    if(s_mixer.voices[i].ref == command.ref)
+                    {
+                        RemoveMixerVoice(i);
+                        break;
+                    }
+                }
+            } break;
+            case MixerCommand_StopSound:
+            {
+                for(s32 i=s_mixer.voiceCount-1; i>=0; --i)
+                    if(s_mixer.voices[i].sound == command.sound)
+                        RemoveMixerVoice(i);
+            } break;
+            case MixerCommand_Volume:
+            {
+                s_mixer.volume = command.volume;
+            } break;
+        }
+    }
+}
+
+// Accumulates 16-bit samples into the float mix buffer, converting a block at a time so the bulk of it can
+// be done four samples at a time.
+static void MixSamples(f32* mix, const s16* samples, s32 count, f32 volume)
+{
+    alignas(16) f32 block[k_mixerBlockSize];
+    for(s32 i=0; i<count; ++i) block[i] = NK_CAST(f32, samples[i]);
+
+    s32 i = 0;
+    #if defined(NK_MATHX_SIMD)
+    nk__f32x4 gain = nk__simd_splat(volume);
+    for(; i+4<=count; i+=4)
+        nk__simd_store(&mix[i], nk__simd_madd(nk__simd_load(&block[i]), gain, nk__simd_load(&mix[i])));
+    #endif // NK_MATHX_SIMD
+    for(; i<count; ++i)
+        mix[i] += block[i] * volume;
+}
+
+// Returns false once the voice has finished.
+static bool MixVoice(MixerVoice& voice, f32 volume, f32* mix, s32 count)
+{
+    const s16* samples = NK_CAST(const s16*, voice.chunk->abuf);
+    u32 length = voice.chunk->alen / sizeof(s16);
+    if(!length) return false;
+
+    while(count > 0)
+    {
+        s32 todo = NK_CAST(s32, std::min<u32>(count, length - voice.position));
+        MixSamples(mix, samples + voice.position, todo, volume);
+        voice.position += todo;
+        mix += todo;
+        count -= todo;
+
+        if(voice.position >= length)
+        {
+            if(!voice.loops) return false;
+            if(voice.loops > 0) voice.loops--;
+            voice.position = 0;
+        }
+    }
+    return true;
+}
+
+static void SDLCALL MixerCallback(void*, Uint8* stream, int len)
+{
+    ProcessMixerCommands();
+
+    u32 voiceCount = NK_CAST(u32, s_mixer.voiceCount);
+    s_mixer.activeVoices.store(voiceCount, std::memory_order_relaxed);
+    if(voiceCount > s_mixer.peakVoices.load(std::memory_order_relaxed))
+        s_mixer.peakVoices.store(voiceCount, std::memory_order_relaxed);
+
+    s16* output = NK_CAST(s16*, stream);
+    s32 remaining = len / NK_CAST(s32, sizeof(s16));
+    while(remaining > 0)
+    {
+        s32 count = std::min(remaining, k_mixerBlockSize);
+
+        alignas(16) f32 mix[k_mixerBlockSize];
+        for(s32 i=0; i<count; ++i) mix[i] = NK_CAST(f32, output[i]); // Start from SDL_mixer's output, i.e. the music.
+        if(s_mixer.offline && s_mixer.music.chunk && !s_mixer.musicPaused)
+            if(!MixVoice(s_mixer.music, s_mixer.musicVolume, mix, count))
+                s_mixer.music.chunk = NULL;
+        for(s32 i=s_mixer.voiceCount-1; i>=0; --i)
+            if(!MixVoice(s_mixer.voices[i], s_mixer.volume, mix, count))
+                RemoveMixerVoice(i);
+        for(s32 i=0; i<count; ++i)
+            output[i] = NK_CAST(s16, nk_clamp(mix[i], -32768.0f, 32767.0f));
+
+        output += count;
+        remaining -= count;
+    }
+}
+
+static void InitAudio(bool offline)
 {
     if(!(Mix_Init(MIX_INIT_OGG) & MIX_INIT_OGG))
         FatalError("Failed to initialize SDL2 Mixer OGG support! (%s)\n", Mix_GetError());
-    if(Mix_OpenAudio(k_mixerFrequency, k_mixerSampleFormat, k_mixerChannels, k_mixerSampleSize) != 0)
+    if(Mix_OpenAudio(k_mixerFrequency, k_mixerSampleFormat, k_mixerChannels, GetAppConfig().audioBufferSize) != 0)
         FatalError("Failed to open SDL2 Mixer audio device! (%s)\n", Mix_GetError());
-    Mix_AllocateChannels(32);
+
+    // Sounds get converted to the device's format on load, SDL_mixer only lets the frequency and channels change.
+    s32 frequency,channels; u16 format;
+    if(!Mix_QuerySpec(&frequency, &format, &channels) || format != AUDIO_S16SYS)
+        FatalError("Failed to open SDL2 Mixer audio device with 16-bit samples!\n");
+
+    Mix_AllocateChannels(0); // We mix the sounds ourselves.
+    s_audioContext.tick = 1; // Sounds start out having last played on tick zero.
+    s_mixer.volume = 1.0f;
+    s_mixer.musicVolume = 1.0f;
+    s_mixer.open = true;
+    s_mixer.offline = offline;
+    if(!offline) Mix_SetPostMix(MixerCallback, NULL);
 }
 
 static void QuitAudio()
 {
+    if(!s_mixer.offline) Mix_SetPostMix(NULL, NULL);
+    s_mixer.open = false;
     Mix_CloseAudio();
 }
 
+static void RenderOfflineAudio(s16* samples, s32 count)
+{
+    ASSERT(s_mixer.offline, "Audio can only be rendered by hand when offline!");
+    memset(samples, 0, count * sizeof(s16));
+    MixerCallback(NULL, NK_CAST(Uint8*, samples), count * NK_CAST(s32, sizeof(s16)));
+}
+
+static void UpdateAudio()
+{
+    s_audioContext.tick++;
+}
+
+static AudioStats GetAudioStats()
+{
+    AudioStats stats;
+    stats.activeVoices = s_mixer.activeVoices.load(std::memory_order_relaxed);
+    stats.peakVoices = s_mixer.peakVoices.load(std::memory_order_relaxed);
+    stats.played = s_mixer.played.load(std::memory_order_relaxed);
+    stats.deduped = s_mixer.deduped;
+    stats.dropped = s_mixer.dropped.load(std::memory_order_relaxed);
+    stats.stolen = s_mixer.stolen.load(std::memory_order_relaxed);
+    return stats;
+}
+
+static void PrintAudioStats()
+{
+    AudioStats stats = GetAudioStats();
+    printf("Audio Stats:\n");
+    printf("  Voices:  %u active, %u peak, %d max\n", stats.activeVoices, stats.peakVoices, k_mixerVoices);
+    printf("  Played:  %llu\n", NK_CAST(unsigned long long, stats.played));
+    printf("  Deduped: %llu\n", NK_CAST(unsigned long long, stats.deduped));
+    printf("  Dropped: %llu\n", NK_CAST(unsigned long long, stats.dropped));
+    printf("  Stolen:  %llu\n", NK_CAST(unsigned long long, stats.stolen));
+}
+
 static void SetSoundVolume(f32 volume)
 {
     s_audioContext.soundVolume = nk_clamp(volume, 0.0f, 1.0f);
-    s32 iVolume = NK_CAST(s32, NK_CAST(f32, MIX_MAX_VOLUME) * s_audioContext.soundVolume);
-    Mix_Volume(-1, iVolume);
+    RecordAudioEvent("volume %f", s_audioContext.soundVolume);
+    MixerCommand command = {};
+    command.type = MixerCommand_Volume;
+    command.volume = s_audioContext.soundVolume;
+    if(!PushMixerCommand(command))
+        printf("Failed to set sound volume! (Mixer command queue is full)\n");
 }
 
 static void SetMusicVolume(f32 volume)
 {
     s_audioContext.musicVolume = nk_clamp(volume, 0.0f, 1.0f);
+    RecordAudioEvent("musicvolume %f", s_audioContext.musicVolume);
     s32 iVolume = NK_CAST(int, NK_CAST(f32, MIX_MAX_VOLUME) * s_audioContext.musicVolume);
     Mix_VolumeMusic(iVolume);
+    s_mixer.musicVolume = s_audioContext.musicVolume;
 }
 
 static f32 GetSoundVolume()
@@ -71,6 +424,7 @@ static bool IsMusicOn()
 
 static bool IsMusicPlaying()
 {
+    if(s_mixer.offline) return (s_mixer.music.chunk != NULL);
     return Mix_PlayingMusic();
 }
 
@@ -78,73 +432,258 @@ static bool IsMusicPlaying()
 // Sound
 //
 
-static bool LoadSoundFromFile(Sound& sound, std::string fileName)
+#if !defined(__EMSCRIPTEN__)
+// 64-bit FNV-1a, same as the shader cache, a false match would play the wrong sound.
+static u64 HashSoundData(const void* data, size_t bytes)
 {
-    sound = Allocate<GET_PTR_TYPE(sound)>(MEM_SYSTEM);
-    if(!sound) FatalError("Failed to allocate sound!\n");
+    u64 hash = 14695981039346656037ull;
+    const u8* ptr = NK_CAST(const u8*, data);
+    for(size_t i=0; i<bytes; ++i) hash = (hash ^ ptr[i]) * 1099511628211ull;
+    return hash;
+}
 
-    sound->chunk = Mix_LoadWAV(fileName.c_str());
+static SoundCacheHeader GetSoundCacheKey(const void* data, size_t bytes)
+{
+    s32 frequency = 0, channels = 0; u16 format = 0;
+    Mix_QuerySpec(&frequency, &format, &channels);
+
+    SoundCacheHeader key = {};
+    key.magic = k_soundCacheMagic;
+    key.version = k_soundCacheVersion;
+    key.sourceHash = HashSoundData(data, bytes);
+    key.sourceSize = bytes;
+    key.frequency = frequency;
+    key.format = format;
+    key.channels = NK_CAST(u16, channels);
+    return key;
+}
+
+static std::string GetSoundCacheFileName(std::string cacheName)
+{
+    return GetExecPath() + "cache/sounds/" + cacheName + ".pcm";
+}
+
+static bool LoadSoundFromCache(Sound& sound, std::string cacheName, const SoundCacheHeader& key)
+{
+    std::string fileName = GetSoundCacheFileName(cacheName);
+    if(!DoesFileExist(fileName)) return false;
+    std::vector<u8> file = ReadBinaryFile(fileName);
+    if(file.size() < sizeof(SoundCacheHeader)) return false;
+
+    SoundCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if(header.magic != key.magic || header.version != key.version) return false;
+    if(header.sourceHash != key.sourceHash || header.sourceSize != key.sourceSize) return false;
+    if(header.frequency != key.frequency || header.format != key.format || header.channels != key.channels) return false;
+    if(file.size() != sizeof(SoundCacheHeader) + header.bytes) return false;
+
+    // The chunk doesn't take ownership of the samples, they stay in the file data which lives as long as the sound.
+    sound->cached = std::move(file);
+    sound->chunk = Mix_QuickLoad_RAW(sound->cached.data() + sizeof(SoundCacheHeader), header.bytes);
     if(!sound->chunk)
-        FatalError("Failed to load sound: %s (%s)\n", fileName.c_str(), Mix_GetError());
+    {
+        sound->cached.clear();
+        return false;
+    }
     return true;
 }
 
-static bool LoadSoundFromData(Sound& sound, void* data, size_t bytes)
+static void SaveSoundToCache(Sound& sound, std::string cacheName, const SoundCacheHeader& key)
+{
+    SoundCacheHeader header = key;
+    header.bytes = sound->chunk->alen;
+
+    std::vector<u8> file(sizeof(SoundCacheHeader) + header.bytes);
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), sound->chunk->abuf, header.bytes);
+
+    // Written to the side and moved into place so a half written file never gets picked up.
+    std::string fileName = GetSoundCacheFileName(cacheName);
+    std::string tempFileName = fileName + ".tmp";
+    CreatePath(GetFilePath(fileName));
+    std::error_code error;
+    if(!WriteBinaryFile(tempFileName, file.data(), file.size()))
+    {
+        printf("Failed to write sound cache: %s\n", fileName.c_str());
+        std::filesystem::remove(tempFileName, error);
+        return;
+    }
+    std::filesystem::rename(tempFileName, fileName, error);
+    if(error) printf("Failed to write sound cache: %s\n", fileName.c_str());
+}
+#endif // __EMSCRIPTEN__
+
+static bool LoadSoundFromFile(Sound& sound, std::string fileName, std::string cacheName)
+{
+    std::vector<u8> data = ReadBinaryFile(fileName);
+    if(data.empty())
+        FatalError("Failed to load sound: %s\n", fileName.c_str());
+    return LoadSoundFromData(sound, data.data(), data.size(), cacheName);
+}
+
+static bool LoadSoundFromData(Sound& sound, void* data, size_t bytes, std::string cacheName)
 {
     sound = Allocate<GET_PTR_TYPE(sound)>(MEM_SYSTEM);
     if(!sound) FatalError("Failed to allocate sound!\n");
 
+    #if !defined(__EMSCRIPTEN__)
+    SoundCacheHeader key = GetSoundCacheKey(data, bytes);
+    if(!cacheName.empty() && LoadSoundFromCache(sound, cacheName, key)) return true;
+    #else
+    NK_UNUSED(cacheName);
+    #endif // __EMSCRIPTEN__
+
     SDL_RWops* rwops = SDL_RWFromMem(data, NK_CAST(int, bytes));
     if(!rwops)
         FatalError("Failed to create RWops from data! (%s)", SDL_GetError());
     sound->chunk = Mix_LoadWAV_RW(rwops, SDL_TRUE);
     if(!sound->chunk)
         FatalError("Failed to load sound from data! (%s)", Mix_GetError());
+
+    #if !defined(__EMSCRIPTEN__)
+    if(!cacheName.empty()) SaveSoundToCache(sound, cacheName, key);
+    #endif // __EMSCRIPTEN__
+
     return true;
 }
 
 static void FreeSound(Sound& sound)
 {
+    // The mixer may still be reading the sound's samples so wait for it to stop every voice using it.
+    if(s_mixer.open && sound->voices.load(std::memory_order_acquire))
+    {
+        MixerCommand command = {};
+        command.type = MixerCommand_StopSound;
+        command.sound = sound;
+        if(s_mixer.offline) // Nothing else is going to drain the queue.
+        {
+            while(!PushMixerCommand(command)) ProcessMixerCommands();
+            ProcessMixerCommands();
+        }
+        else
+        {
+            while(!PushMixerCommand(command)) SDL_Delay(1);
+            while(sound->voices.load(std::memory_order_acquire)) SDL_Delay(1);
+        }
+    }
     Mix_FreeChunk(sound->chunk);
     Deallocate(sound);
 }
 
-static SoundRef PlaySound(std::string soundName, s32 loops)
+static size_t GetSoundBytes(const Sound& sound)
+{
+    return (sound) ? NK_CAST(size_t, sound->chunk->alen) : 0;
+}
+
+static bool IsSoundPlaying(const Sound& sound)
+{
+    return (sound && sound->voices.load(std::memory_order_acquire) > 0);
+}
+
+static SoundRef PlaySound(std::string soundName, s32 loops, SoundPriority priority, s32 maxInstances)
 {
     Sound sound = *GetAsset<Sound>(soundName);
-    if(sound) return PlaySound(sound, loops);
-    return k_invalidSoundRef;
+    SoundRef ref = (sound) ? PlaySound(sound, loops, priority, maxInstances) : k_invalidSoundRef;
+    RecordAudioEvent("sound %s %d %d %d %u", soundName.c_str(), loops, priority, maxInstances, ref);
+    return ref;
+}
+
+static SoundRef PlaySound(AssetHandle<Sound>& soundHandle, s32 loops, SoundPriority priority, s32 maxInstances)
+{
+    Sound* sound = GetAsset(soundHandle);
+    SoundRef ref = (sound) ? PlaySound(*sound, loops, priority, maxInstances) : k_invalidSoundRef;
+    RecordAudioEvent("sound %s %d %d %d %u", soundHandle.m_name, loops, priority, maxInstances, ref);
+    return ref;
 }
 
-static SoundRef PlaySound(Sound sound, s32 loops)
+static SoundRef PlaySound(Sound sound, s32 loops, SoundPriority priority, s32 maxInstances)
 {
-    if(!sound) return k_invalidSoundRef;
-    s32 channel = Mix_PlayChannel(-1, sound->chunk, loops);
-    if(channel == -1)
+    if(!sound || !s_mixer.open) return k_invalidSoundRef;
+
+    // Multiple copies of a sound starting on the same tick just sound like one loud one.
+    if(loops == 0 && sound->lastPlayedTick == s_audioContext.tick)
+    {
+        s_mixer.deduped++;
+        return k_invalidSoundRef;
+    }
+    sound->lastPlayedTick = s_audioContext.tick;
+
+    MixerCommand command = {};
+    command.type = MixerCommand_Play;
+    command.ref = s_mixer.nextRef++;
+    command.sound = sound;
+    command.loops = loops;
+    command.priority = priority;
+    command.maxInstances = maxInstances;
+    if(s_mixer.nextRef == k_invalidSoundRef) s_mixer.nextRef = 0;
+
+    sound->voices.fetch_add(1, std::memory_order_relaxed);
+    if(!PushMixerCommand(command))
     {
-        printf("Failed to play sound effect! (%s)\n", Mix_GetError());
+        sound->voices.fetch_sub(1, std::memory_order_relaxed);
+        printf("Failed to play sound effect! (Mixer command queue is full)\n");
         return k_invalidSoundRef;
     }
-    return NK_CAST(SoundRef,channel);
+    return command.ref;
 }
 
 static void StopSound(SoundRef soundRef)
 {
-    Mix_HaltChannel(soundRef);
+    if(soundRef == k_invalidSoundRef) return;
+    RecordAudioEvent("stop %u", soundRef);
+    MixerCommand command = {};
+    command.type = MixerCommand_Stop;
+    command.ref = soundRef;
+    if(!PushMixerCommand(command))
+        printf("Failed to stop sound effect! (Mixer command queue is full)\n");
 }
 
 //
 // Music
 //
 
+static bool OpenMusic(Music music)
+{
+    if(music->music || music->chunk) return true;
+
+    SDL_RWops* rwops = NULL;
+    if(music->entry) rwops = OpenVfsStream(*music->entry);
+    else if(!music->data.empty()) rwops = SDL_RWFromConstMem(music->data.data(), NK_CAST(int, music->data.size()));
+    else rwops = SDL_RWFromFile(music->fileName.c_str(), "rb");
+    if(!rwops) return false;
+
+    if(s_mixer.offline)
+    {
+        music->chunk = Mix_LoadWAV_RW(rwops, SDL_TRUE);
+        return (music->chunk != NULL);
+    }
+    music->music = Mix_LoadMUS_RW(rwops, SDL_TRUE);
+    return (music->music != NULL);
+}
+
+static void CloseMusic(Music music)
+{
+    if(music->chunk)
+    {
+        if(s_mixer.music.chunk == music->chunk) s_mixer.music.chunk = NULL;
+        Mix_FreeChunk(music->chunk);
+        music->chunk = NULL;
+    }
+    if(!music->music) return;
+    Mix_FreeMusic(music->music); // Halts the music first if it is playing.
+    music->music = NULL;
+}
+
 static bool LoadMusicFromFile(Music& music, std::string fileName)
 {
     music = Allocate<GET_PTR_TYPE(music)>(MEM_SYSTEM);
     if(!music) FatalError("Failed to allocate music!\n");
 
-    music->music = Mix_LoadMUS(fileName.c_str());
-    if(!music->music)
+    // Open it once so that bad music gets caught at load time rather than when it comes to be played.
+    music->fileName = fileName;
+    if(!OpenMusic(music))
         FatalError("Failed to load music: %s (%s)\n", fileName.c_str(), Mix_GetError());
+    CloseMusic(music);
     return true;
 }
 
@@ -153,45 +692,109 @@ static bool LoadMusicFromData(Music& music, void* data, size_t bytes)
     music = Allocate<GET_PTR_TYPE(music)>(MEM_SYSTEM);
     if(!music) FatalError("Failed to allocate music!\n");
 
-    SDL_RWops* rwops = SDL_RWFromMem(data, NK_CAST(int, bytes));
-    if(!rwops)
-        FatalError("Failed to create RWops from data! (%s)", SDL_GetError());
-    music->music = Mix_LoadMUS_RW(rwops, SDL_TRUE);
-    if(!music->music)
+    music->data.assign(NK_CAST(u8*, data), NK_CAST(u8*, data) + bytes);
+    if(!OpenMusic(music))
         FatalError("Failed to load music from data! (%s)", Mix_GetError());
+    CloseMusic(music);
+    return true;
+}
+
+static bool LoadMusicFromStream(Music& music, const VfsEntry& entry)
+{
+    music = Allocate<GET_PTR_TYPE(music)>(MEM_SYSTEM);
+    if(!music) FatalError("Failed to allocate music!\n");
+
+    music->entry = &entry;
+    if(!OpenMusic(music))
+        FatalError("Failed to load music: %s (%s)\n", entry.name.c_str(), Mix_GetError());
+    CloseMusic(music);
     return true;
 }
 
 static void FreeMusic(Music& music)
 {
-    Mix_FreeMusic(music->music);
+    if(s_audioContext.currentMusic == music)
+        s_audioContext.currentMusic = NULL;
+    CloseMusic(music);
     Deallocate(music);
 }
 
+static size_t GetMusicBytes(const Music& music)
+{
+    return (music) ? music->data.size() : 0;
+}
+
+static bool IsMusicCurrent(const Music& music)
+{
+    return (music && s_audioContext.currentMusic == music && IsMusicPlaying());
+}
+
+// The current track's asset is acquired so it stays resident for as long as it plays, whatever the budget.
+static void ReleaseCurrentMusicAsset()
+{
+    if(s_audioContext.currentMusicAsset.empty()) return;
+    ReleaseAsset<Music>(s_audioContext.currentMusicAsset);
+    s_audioContext.currentMusicAsset.clear();
+}
+
 static void PlayMusic(std::string musicName, s32 loops)
 {
-    Music music = *GetAsset<Music>(musicName);
-    if(music) PlayMusic(music, loops);
+    RecordAudioEvent("music %s %d", musicName.c_str(), loops);
+    Music* music = AcquireAsset<Music>(musicName);
+    ReleaseCurrentMusicAsset();
+    s_audioContext.currentMusicAsset = musicName;
+    if(music) PlayMusic(*music, loops);
+}
+
+static void PlayMusic(AssetHandle<Music>& musicHandle, s32 loops)
+{
+    RecordAudioEvent("music %s %d", musicHandle.m_name, loops);
+    Music* music = AcquireAsset(musicHandle);
+    ReleaseCurrentMusicAsset();
+    s_audioContext.currentMusicAsset = musicHandle.m_name;
+    if(music) PlayMusic(*music, loops);
 }
 
 static void PlayMusic(Music music, s32 loops)
 {
     if(!music) return;
-    if(Mix_PlayMusic(music->music, loops) == -1)
+
+    // Only the current track is kept open so close the last one before opening the next.
+    if(s_audioContext.currentMusic && s_audioContext.currentMusic != music)
+        CloseMusic(s_audioContext.currentMusic);
+    s_audioContext.currentMusic = music;
+
+    if(!OpenMusic(music))
+        printf("Failed to open music! (%s)\n", Mix_GetError());
+    else if(s_mixer.offline)
+    {
+        s_mixer.music = { NULL, music->chunk, k_invalidSoundRef, 0, loops, SoundPriority_Critical, 0 };
+        s_mixer.musicPaused = false;
+    }
+    else if(Mix_PlayMusic(music->music, loops) == -1)
         printf("Failed to play music! (%s)\n", Mix_GetError());
 }
 
 static void ResumeMusic()
 {
+    RecordAudioEvent("resumemusic");
+    s_mixer.musicPaused = false;
     Mix_ResumeMusic();
 }
 
 static void PauseMusic()
 {
+    RecordAudioEvent("pausemusic");
+    s_mixer.musicPaused = true;
     Mix_PauseMusic();
 }
 
 static void StopMusic()
 {
+    RecordAudioEvent("stopmusic");
     Mix_HaltMusic();
+    if(s_audioContext.currentMusic)
+        CloseMusic(s_audioContext.currentMusic);
+    s_audioContext.currentMusic = NULL;
+    ReleaseCurrentMusicAsset();
 }
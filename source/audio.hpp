@@ -3,13 +3,43 @@ typedef u32 SoundRef;
 DECLARE_PRIVATE_STRUCT(Sound);
 DECLARE_PRIVATE_STRUCT(Music);
 
+DECLARE_MEMORY_POOL(Sound);
+
 static constexpr f32 k_defaultSoundVolume = 0.8f;
 static constexpr f32 k_defaultMusicVolume = 0.6f;
 
 static constexpr SoundRef k_invalidSoundRef = 0xFFFFFFFF;
 
-static void InitAudio();
+static constexpr s32 k_defaultSoundInstances = 4; // Max voices a sound can have at once before it starts replacing its oldest.
+
+// When the mixer runs out of voices it takes the lowest priority one (the oldest if tied) as long as it isn't
+// higher priority than the new sound. Critical voices and anything looping forever are never taken, the game
+// expects those to keep going until it stops them (e.g. the rocket's thruster).
+enum SoundPriority
+{
+    SoundPriority_Low,
+    SoundPriority_Normal,
+    SoundPriority_High,
+    SoundPriority_Critical
+};
+
+struct AudioStats
+{
+    u32 activeVoices;
+    u32 peakVoices;
+    u64 played;
+    u64 deduped; // Same sound played more than once in a tick.
+    u64 dropped; // No voice that could be taken for it.
+    u64 stolen;  // Voices cut short to make room.
+};
+
+static void InitAudio(bool offline = false); // Offline nothing plays, the mix is pulled with RenderOfflineAudio.
 static void QuitAudio();
+static void RenderOfflineAudio(s16* samples, s32 count); // Interleaved, in the format from Mix_QuerySpec.
+static void UpdateAudio(); // Once per tick, before the app updates.
+
+static AudioStats GetAudioStats();
+static void PrintAudioStats();
 
 static void SetSoundVolume(f32 volume); // [0-1]
 static void SetMusicVolume(f32 volume); // [0-1]
@@ -23,18 +53,27 @@ static bool IsMusicOn();
 static bool IsMusicPlaying();
 
 // Sound
-static bool LoadSoundFromFile(Sound& sound, std::string fileNmae);
-static bool LoadSoundFromData(Sound& sound, void* data, size_t bytes);
+// The cache name is what the decoded samples are cached on disk under, sounds without one are never cached.
+static bool LoadSoundFromFile(Sound& sound, std::string fileNmae, std::string cacheName = "");
+static bool LoadSoundFromData(Sound& sound, void* data, size_t bytes, std::string cacheName = "");
 static void FreeSound(Sound& sound);
-static SoundRef PlaySound(std::string soundName, s32 loops = 0);
-static SoundRef PlaySound(Sound sound, s32 loops = 0);
+static size_t GetSoundBytes(const Sound& sound); // Size of the decoded PCM data.
+static bool IsSoundPlaying(const Sound& sound); // Whether any voice is currently playing the sound.
+// Playing a sound that was already played this tick does nothing, unless it loops.
+static SoundRef PlaySound(std::string soundName, s32 loops = 0, SoundPriority priority = SoundPriority_Normal, s32 maxInstances = k_defaultSoundInstances);
+static SoundRef PlaySound(AssetHandle<Sound>& soundHandle, s32 loops = 0, SoundPriority priority = SoundPriority_Normal, s32 maxInstances = k_defaultSoundInstances);
+static SoundRef PlaySound(Sound sound, s32 loops = 0, SoundPriority priority = SoundPriority_Normal, s32 maxInstances = k_defaultSoundInstances);
 static void StopSound(SoundRef soundRef);
 
 // Music
 static bool LoadMusicFromFile(Music& music, std::string fileName);
 static bool LoadMusicFromData(Music& music, void* data, size_t bytes);
+static bool LoadMusicFromStream(Music& music, const VfsEntry& entry); // Streams from the VFS as it plays.
 static void FreeMusic(Music& music);
+static size_t GetMusicBytes(const Music& music); // Only music loaded from data costs memory whilst it isn't playing.
+static bool IsMusicCurrent(const Music& music); // Whether the music is the one playing (or paused).
 static void PlayMusic(std::string musicName, s32 loops = 0);
+static void PlayMusic(AssetHandle<Music>& musicHandle, s32 loops = 0);
 static void PlayMusic(Music music, s32 loops = 0);
 static void ResumeMusic();
 static void PauseMusic();
@@ -46,9 +85,11 @@ DECLARE_ASSET(Sound)
 public:
     Sound m_data;
 
-    bool        LoadFromFile(std::string fileName) override { return LoadSoundFromFile(m_data, fileName); }
-    bool        LoadFromData(void* data, size_t bytes) override { return LoadSoundFromData(m_data, data, bytes); }
-    void        Free() override { FreeSound(m_data); }
+    bool        LoadFromFile(std::string fileName) override { return LoadSoundFromFile(m_data, fileName, m_name); }
+    bool        LoadFromData(void* data, size_t bytes) override { return LoadSoundFromData(m_data, data, bytes, m_name); }
+    void        Free() override { FreeSound(m_data); m_data = NULL; }
+    size_t      GetResidentBytes() const override { return GetSoundBytes(m_data); }
+    bool        IsInUse() const override { return IsSoundPlaying(m_data); }
     const char* GetPath() const override { return "sounds/"; }
     const char* GetExt() const override { return ".ogg"; }
     const char* GetType() const override { return "Sound"; }
@@ -61,7 +102,10 @@ public:
 
     bool        LoadFromFile(std::string fileName) override { return LoadMusicFromFile(m_data, fileName); }
     bool        LoadFromData(void* data, size_t bytes) override { return LoadMusicFromData(m_data, data, bytes); }
-    void        Free() override { FreeMusic(m_data); }
+    bool        LoadFromStream(const VfsEntry& entry) override { return LoadMusicFromStream(m_data, entry); }
+    void        Free() override { FreeMusic(m_data); m_data = NULL; }
+    size_t      GetResidentBytes() const override { return GetMusicBytes(m_data); }
+    bool        IsInUse() const override { return IsMusicCurrent(m_data); }
     const char* GetPath() const override { return "music/"; }
     const char* GetExt() const override { return ".ogg"; }
     const char* GetType() const override { return "Music"; }
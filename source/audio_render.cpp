@@ -0,0 +1,231 @@
+//
+// Recording
+//
+
+static bool StartAudioRecording(std::string fileName)
+{
+    StopAudioRecording();
+
+    s_audioRecorder.file = fopen(fileName.c_str(), "w");
+    if(!s_audioRecorder.file)
+    {
+        printf("Failed to open audio session for recording: %s\n", fileName.c_str());
+        return false;
+    }
+    s_audioRecorder.startTick = s_audioContext.tick;
+    fprintf(s_audioRecorder.file, "%s %d %f\n", k_audioSessionMagic, k_audioSessionVersion, GetAppConfig().tickrate);
+
+    printf("Recording audio session: %s\n", fileName.c_str());
+    return true;
+}
+
+static void StopAudioRecording()
+{
+    if(!s_audioRecorder.file) return;
+    RecordAudioEvent("end");
+    fclose(s_audioRecorder.file);
+    s_audioRecorder.file = NULL;
+}
+
+static void RecordAudioEvent(const char* format, ...)
+{
+    if(!s_audioRecorder.file) return;
+
+    fprintf(s_audioRecorder.file, "%llu ", NK_CAST(unsigned long long, s_audioContext.tick - s_audioRecorder.startTick));
+    va_list args;
+    va_start(args, format);
+    vfprintf(s_audioRecorder.file, format, args);
+    va_end(args);
+    fprintf(s_audioRecorder.file, "\n");
+}
+
+//
+// Rendering
+//
+
+struct AudioSessionEvent
+{
+    u64 tick;
+    std::string command;
+    std::string args;
+};
+
+static bool LoadAudioSession(std::string fileName, f32& tickrate, std::vector<AudioSessionEvent>& events)
+{
+    std::ifstream file(fileName, std::ios::in);
+    if(!file.is_open())
+    {
+        printf("Failed to open audio session: %s\n", fileName.c_str());
+        return false;
+    }
+
+    std::string line, magic;
+    s32 version = 0;
+    std::getline(file, line);
+    std::istringstream header(line);
+    header >> magic >> version >> tickrate;
+    if(magic != k_audioSessionMagic || version != k_audioSessionVersion || tickrate <= 0.0f)
+    {
+        printf("Failed to load audio session, it is invalid: %s\n", fileName.c_str());
+        return false;
+    }
+
+    while(std::getline(file, line))
+    {
+        AudioSessionEvent event;
+        std::istringstream stream(line);
+        if(!(stream >> event.tick >> event.command)) continue;
+        std::getline(stream >> std::ws, event.args);
+        events.push_back(event);
+    }
+    return true;
+}
+
+static void PlayAudioSessionEvent(const AudioSessionEvent& event, std::unordered_map<SoundRef,SoundRef>& refs)
+{
+    std::istringstream args(event.args);
+    if(event.command == "sound")
+    {
+        std::string name;
+        s32 loops = 0, priority = SoundPriority_Normal, maxInstances = k_defaultSoundInstances;
+        SoundRef ref = k_invalidSoundRef;
+        args >> name >> loops >> priority >> maxInstances >> ref;
+        SoundRef played = PlaySound(name, loops, NK_CAST(SoundPriority, priority), maxInstances);
+        if(ref != k_invalidSoundRef) refs[ref] = played;
+    }
+    else if(event.command == "stop")
+    {
+        SoundRef ref = k_invalidSoundRef;
+        args >> ref;
+        auto it = refs.find(ref);
+        if(it != refs.end())
+        {
+            StopSound(it->second);
+            refs.erase(it);
+        }
+    }
+    else if(event.command == "volume")
+    {
+        f32 volume = 1.0f;
+        args >> volume;
+        SetSoundVolume(volume);
+    }
+    else if(event.command == "music")
+    {
+        std::string name;
+        s32 loops = 0;
+        args >> name >> loops;
+        PlayMusic(name, loops);
+    }
+    else if(event.command == "musicvolume")
+    {
+        f32 volume = 1.0f;
+        args >> volume;
+        SetMusicVolume(volume);
+    }
+    else if(event.command == "pausemusic") PauseMusic();
+    else if(event.command == "resumemusic") ResumeMusic();
+    else if(event.command == "stopmusic") StopMusic();
+    else if(event.command != "end")
+    {
+        printf("Unknown audio session event: %s\n", event.command.c_str());
+    }
+}
+
+// Canonical 44-byte header for 16-bit PCM, the sizes get filled in once we know how much was rendered.
+struct WavHeader
+{
+    char riff[4] = { 'R','I','F','F' };
+    u32  riffSize = 0;
+    char wave[4] = { 'W','A','V','E' };
+    char fmt[4] = { 'f','m','t',' ' };
+    u32  fmtSize = 16;
+    u16  format = 1; // PCM
+    u16  channels = 0;
+    u32  frequency = 0;
+    u32  byteRate = 0;
+    u16  blockAlign = 0;
+    u16  bitsPerSample = 16;
+    char data[4] = { 'd','a','t','a' };
+    u32  dataSize = 0;
+};
+static_assert(sizeof(WavHeader) == 44, "WavHeader must match the on-disk layout!");
+
+static bool RenderAudioSession(std::string sessionFileName, std::string outputFileName)
+{
+    f32 tickrate = 0.0f;
+    std::vector<AudioSessionEvent> events;
+    if(!LoadAudioSession(sessionFileName, tickrate, events))
+        return false;
+    if(events.empty())
+    {
+        printf("Audio session is empty: %s\n", sessionFileName.c_str());
+        return false;
+    }
+
+    s32 frequency,channels; u16 format;
+    Mix_QuerySpec(&frequency, &format, &channels);
+
+    FILE* output = fopen(outputFileName.c_str(), "wb");
+    if(!output)
+    {
+        printf("Failed to open audio render output: %s\n", outputFileName.c_str());
+        return false;
+    }
+    NK_DEFER(fclose(output));
+
+    WavHeader header;
+    header.channels = NK_CAST(u16, channels);
+    header.frequency = NK_CAST(u32, frequency);
+    header.blockAlign = NK_CAST(u16, channels * sizeof(s16));
+    header.byteRate = header.frequency * header.blockAlign;
+    fwrite(&header, sizeof(header), 1, output); // Placeholder until we know the sizes.
+
+    printf("Rendering audio session %s (%zu events)...\n", sessionFileName.c_str(), events.size());
+
+    std::unordered_map<SoundRef,SoundRef> refs; // Recorded refs to the ones we got playing them back.
+    std::vector<s16> samples(k_audioRenderBlockSize * channels);
+    u64 lastTick = events.back().tick;
+    u64 totalFrames = 0;
+    u64 renderTime = 0; // Only the mixing is timed, not the loading of assets or writing of the output.
+    f64 frameAccumulator = 0.0;
+    size_t nextEvent = 0;
+
+    for(u64 tick=0; tick<=lastTick; ++tick)
+    {
+        while(nextEvent < events.size() && events[nextEvent].tick <= tick)
+            PlayAudioSessionEvent(events[nextEvent++], refs);
+
+        // Ticks don't line up with whole frames, so carry the remainder over to the next one.
+        frameAccumulator += NK_CAST(f64, frequency) / NK_CAST(f64, tickrate);
+        s32 frames = NK_CAST(s32, frameAccumulator);
+        frameAccumulator -= NK_CAST(f64, frames);
+
+        while(frames > 0)
+        {
+            s32 count = std::min(frames, k_audioRenderBlockSize);
+            u64 start = SDL_GetPerformanceCounter();
+            RenderOfflineAudio(samples.data(), count * channels);
+            renderTime += SDL_GetPerformanceCounter() - start;
+            fwrite(samples.data(), sizeof(s16), count * channels, output);
+            totalFrames += count;
+            frames -= count;
+        }
+
+        UpdateAudio();
+    }
+
+    header.dataSize = NK_CAST(u32, totalFrames * header.blockAlign);
+    header.riffSize = header.dataSize + sizeof(WavHeader) - 8;
+    fseek(output, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output);
+
+    f64 seconds = NK_CAST(f64, renderTime) / NK_CAST(f64, SDL_GetPerformanceFrequency());
+    f64 duration = NK_CAST(f64, totalFrames) / NK_CAST(f64, frequency);
+    printf("Rendered %.2fs of audio (%llu sample frames) in %.3fms\n", duration, NK_CAST(unsigned long long, totalFrames), seconds * 1000.0);
+    if(seconds > 0.0)
+        printf("  %.0f sample frames/sec, %.1fx realtime\n", NK_CAST(f64, totalFrames) / seconds, duration / seconds);
+    PrintAudioStats();
+
+    return true;
+}
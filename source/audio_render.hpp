@@ -0,0 +1,33 @@
+// Offline audio rendering, for measuring the mixer on machines without a sound card (e.g. CI). A session of
+// audio calls is recorded from a normal run of the game (-recordaudio <session>) and then replayed tick by
+// tick against a virtual device as fast as possible (-renderaudio <session> <output.wav>), writing the mix
+// out as a WAV and reporting how many samples were mixed per second so regressions show up as numbers.
+//
+// Sessions are plain text, a header followed by one call per line prefixed with the tick it was made on:
+//
+//   rocket-audio-session <version> <tickrate>
+//   <tick> sound <name> <loops> <priority> <maxInstances> <ref>
+//   <tick> stop <ref>
+//   <tick> volume <volume>
+//   <tick> music <name> <loops>
+//   <tick> musicvolume <volume>
+//   <tick> pausemusic|resumemusic|stopmusic
+//   <tick> end
+
+static constexpr const char* k_audioSessionMagic = "rocket-audio-session";
+static constexpr s32 k_audioSessionVersion = 1;
+static constexpr s32 k_audioRenderBlockSize = 1024; // Sample frames rendered at a time.
+
+struct AudioRecorder
+{
+    FILE* file;
+    u64 startTick;
+};
+
+static AudioRecorder s_audioRecorder;
+
+static bool StartAudioRecording(std::string fileName);
+static void StopAudioRecording();
+static void RecordAudioEvent(const char* format, ...); // Does nothing if we're not recording.
+
+static bool RenderAudioSession(std::string sessionFileName, std::string outputFileName); // Expects InitAudio(true).
@@ -1,5 +1,9 @@
 static void CreateBackground()
 {
+    // The layers are wrapped vertically by the sampler when they get composited in the background shader.
+    Texture* texture = GetAsset(s_backTexture);
+    if(texture && *texture) SetTextureWrap(*texture, Wrap_Repeat);
+
     f32 speed = 360.0f;
     for(s32 i=k_backCount-1; i>=0; --i)
     {
@@ -22,20 +26,28 @@ static void UpdateBackground(f32 dt)
 
 static void RenderBackground(f32 dt)
 {
-    Clear(0.0f, 0.05f, 0.2f);
-
     f32 screenWidth = GetScreenWidth();
     f32 screenHeight = GetScreenHeight();
 
-    Rect clip = { 0, 0, 180, 320 };
-    nkVec4 color = { 1,1,1,0.4f };
+    // All of the layers are composited in a single full-screen pass. Each layer is a column of the texture and
+    // the offset of each is given as a texture coordinate, the shader does the wrapping and blending.
+    Shader* shader = GetAsset(s_backShader);
+    if(!shader || !*shader) return;
 
-    imm::BeginTextureBatch("back");
+    f32 offsets[k_backCount];
     for(s32 i=0; i<k_backCount; ++i)
-    {
-        imm::DrawBatchedTexture(screenWidth*0.5f,s_backOffset[i], &clip, color);
-        imm::DrawBatchedTexture(screenWidth*0.5f,s_backOffset[i]-screenHeight, &clip, color);
-        clip.x += 180.0f;
-    }
-    imm::EndTextureBatch();
+        offsets[i] = (s_backOffset[i] / screenHeight) - 0.5f;
+
+    imm::SetCurrentShader(*shader);
+
+    UseShader(*shader);
+    SetShaderVec4("u_baseColor", { 0.0f, 0.05f, 0.2f, 1.0f });
+    SetShaderFloat("u_layerStride", 1.0f / NK_CAST(f32, k_backCount));
+    SetShaderFloatArray("u_layerOffsets", offsets, k_backCount);
+
+    Rect clip = { 0, 0, 180, 320 };
+    nkVec4 color = imm::PremultiplyColor({ 1,1,1,0.4f });
+    imm::DrawTexture(s_backTexture, screenWidth*0.5f,screenHeight*0.5f, &clip, color);
+
+    imm::SetCurrentShader(NULL);
 }
@@ -5,6 +5,9 @@ static constexpr s32 k_backCount = 3;
 static f32 s_backSpeed[k_backCount];
 static f32 s_backOffset[k_backCount];
 
+static AssetHandle<Texture> s_backTexture("back");
+static AssetHandle<Shader> s_backShader("background");
+
 static void CreateBackground();
 static void UpdateBackground(f32 dt);
 static void RenderBackground(f32 dt);
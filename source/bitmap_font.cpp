@@ -1,15 +1,4 @@
-static void LoadBitmapFont(BitmapFont& font, f32 cw, f32 ch, std::string texture)
-{
-    font.texture = texture;
-    font.charWidth = cw;
-    font.charHeight = ch;
-
-    for(s32 iy=0; iy<3; ++iy)
-        for(s32 ix=0; ix<32; ++ix)
-            font.bounds[iy*32+ix] = { NK_CAST(f32,ix)*cw, NK_CAST(f32,iy)*ch, cw, ch };
-}
-
-static f32 GetCharWidth(BitmapFont& font, char c)
+static f32 GetDefaultCharWidth(BitmapFont& font, char c)
 {
     if(font.charWidth == 14) // Small font.
     {
@@ -50,7 +39,42 @@ static f32 GetCharWidth(BitmapFont& font, char c)
     return font.charWidth;
 }
 
-static f32 GetTextLineWidth(BitmapFont& font, std::string text, s32 line)
+static void LoadBitmapFont(BitmapFont& font, f32 cw, f32 ch, const char* texture)
+{
+    font.texture = AssetHandle<Texture>(texture);
+    AcquireAsset(font.texture);
+    font.charWidth = cw;
+    font.charHeight = ch;
+
+    for(s32 iy=0; iy<3; ++iy)
+        for(s32 ix=0; ix<32; ++ix)
+            font.bounds[iy*32+ix] = { NK_CAST(f32,ix)*cw, NK_CAST(f32,iy)*ch, cw, ch };
+
+    for(s32 i=0; i<256; ++i)
+        font.advance[i] = roundf(GetDefaultCharWidth(font, NK_CAST(char,i)));
+
+    // Any cached layouts for the font are out of date now. Also reserve space up-front so laying out text
+    // during gameplay doesn't have to allocate (the vectors are only cleared when a layout is replaced).
+    for(BitmapFontLayout& layout: s_bitmapFontLayouts)
+    {
+        if(layout.font == &font) layout.font = NULL;
+        layout.lineOffsets.reserve(k_bitmapFontLayoutLineReserve);
+        layout.glyphs.reserve(k_bitmapFontLayoutGlyphReserve);
+    }
+}
+
+static void FreeBitmapFont(BitmapFont& font)
+{
+    ReleaseAsset(font.texture);
+    font.texture = AssetHandle<Texture>();
+}
+
+static f32 GetCharWidth(BitmapFont& font, char c)
+{
+    return font.advance[NK_CAST(u8,c)];
+}
+
+static f32 GetTextLineWidth(BitmapFont& font, std::string_view text, s32 line)
 {
     f32 lineWidth = 0;
     s32 lineIndex = 0;
@@ -69,32 +93,110 @@ static f32 GetTextLineWidth(BitmapFont& font, std::string text, s32 line)
     return lineWidth;
 }
 
-static void DrawBitmapFont(BitmapFont& font, f32 x, f32 y, std::string text, nkVec4 color)
+static const BitmapFontLayout* GetBitmapFontLayout(BitmapFont& font, std::string_view text)
 {
-    // NOTE: We just assume the caller wants multi-line text to be center aligned.
+    Texture* texture = GetAsset(font.texture);
+    if(!texture || !*texture) return NULL;
+
+    f32 textureWidth = GetTextureWidth(*texture);
+    f32 textureHeight = GetTextureHeight(*texture);
+
+    u32 hash = k_assetHashSeed;
+    for(char c: text)
+        hash = (hash ^ NK_CAST(u8,c)) * 16777619u;
+
+    s_bitmapFontLayoutTick++;
+
+    // Look for an existing layout, otherwise pick the least recently used one to replace.
+    BitmapFontLayout* layout = &s_bitmapFontLayouts[0];
+    for(BitmapFontLayout& cached: s_bitmapFontLayouts)
+    {
+        if(cached.font == &font && cached.hash == hash && cached.text == text &&
+           cached.textureWidth == textureWidth && cached.textureHeight == textureHeight)
+        {
+            cached.lastUsed = s_bitmapFontLayoutTick;
+            return &cached;
+        }
+        if(cached.lastUsed < layout->lastUsed)
+            layout = &cached;
+    }
 
-    f32 ix = x;
-    f32 iy = y;
+    layout->font = &font;
+    layout->hash = hash;
+    layout->lastUsed = s_bitmapFontLayoutTick;
+    layout->textureWidth = textureWidth;
+    layout->textureHeight = textureHeight;
+    layout->text = text;
+    layout->lineOffsets.clear();
+    layout->glyphs.clear();
 
+    // NOTE: We just assume the caller wants multi-line text to be center aligned.
+
+    f32 firstLineWidth = GetTextLineWidth(font, text, 0);
+    f32 lineWidth = 0.0f;
+    f32 ix = 0.0f;
     s32 line = 0;
 
-    nkVec2 anchor = { 0,0 };
+    layout->lineOffsets.push_back(0.0f);
 
-    imm::BeginTextureBatch(font.texture);
-    for(size_t i=0; i<text.length(); ++i)
+    for(size_t i=0; i<=text.length(); ++i)
     {
-        if(text[i] == '\n')
+        if(i == text.length() || text[i] == '\n')
         {
-            ix = roundf(x + (GetTextLineWidth(font, text, 0)*0.5f) - (GetTextLineWidth(font, text, line+1)*0.5f));
-            iy += font.charHeight;
+            // Now we know the width of the line we can work out the offset needed to center it.
+            if(line > 0) layout->lineOffsets[line] = (firstLineWidth*0.5f) - (lineWidth*0.5f);
+            if(i == text.length()) break;
+            layout->lineOffsets.push_back(0.0f);
+            lineWidth = 0.0f;
+            ix = 0.0f;
             line++;
         }
         else
         {
-            Rect bounds = font.bounds[NK_CAST(u8,text.at(i))];
-            imm::DrawBatchedTexture(ix,iy, 1.0f,1.0f, 0.0f, imm::Flip_None, &anchor, &bounds, color);
-            ix += roundf(GetCharWidth(font, text[i]));
+            const Rect& bounds = font.bounds[NK_CAST(u8,text[i])];
+
+            BitmapFontGlyph glyph;
+            glyph.line = line;
+            glyph.x1 = ix;
+            glyph.y1 = font.charHeight * NK_CAST(f32,line);
+            glyph.x2 = glyph.x1 + bounds.w;
+            glyph.y2 = glyph.y1 + bounds.h;
+            glyph.s1 = bounds.x / textureWidth;
+            glyph.t1 = bounds.y / textureHeight;
+            glyph.s2 = (bounds.x + bounds.w) / textureWidth;
+            glyph.t2 = (bounds.y + bounds.h) / textureHeight;
+            layout->glyphs.push_back(glyph);
+
+            ix += GetCharWidth(font, text[i]);
+            lineWidth += GetCharWidth(font, text[i]);
         }
     }
+
+    return layout;
+}
+
+static void DrawBitmapFont(BitmapFont& font, f32 x, f32 y, std::string_view text, nkVec4 color)
+{
+    const BitmapFontLayout* layout = GetBitmapFontLayout(font, text);
+    if(!layout) return;
+
+    imm::BeginTextureBatch(font.texture);
+    for(const BitmapFontGlyph& glyph: layout->glyphs)
+    {
+        // The first line starts exactly where asked, the rest are snapped to whole pixels once centered.
+        f32 lx = (glyph.line == 0) ? x : roundf(x + layout->lineOffsets[glyph.line]);
+
+        f32 x1 = lx + glyph.x1;
+        f32 y1 = y + glyph.y1;
+        f32 x2 = lx + glyph.x2;
+        f32 y2 = y + glyph.y2;
+
+        imm::PutVertex({ {x1,y2,0,1}, color, {glyph.s1,glyph.t2} }); // BL
+        imm::PutVertex({ {x1,y1,0,1}, color, {glyph.s1,glyph.t1} }); // TL
+        imm::PutVertex({ {x2,y1,0,1}, color, {glyph.s2,glyph.t1} }); // TR
+        imm::PutVertex({ {x2,y1,0,1}, color, {glyph.s2,glyph.t1} }); // TR
+        imm::PutVertex({ {x2,y2,0,1}, color, {glyph.s2,glyph.t2} }); // BR
+        imm::PutVertex({ {x1,y2,0,1}, color, {glyph.s1,glyph.t2} }); // BL
+    }
     imm::EndTextureBatch();
 }
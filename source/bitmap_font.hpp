@@ -3,7 +3,8 @@
 struct BitmapFont
 {
     Rect bounds[256];
-    std::string texture;
+    f32 advance[256]; // Width of each character, already rounded as the text is laid out on whole pixels.
+    AssetHandle<Texture> texture;
     f32 charWidth;
     f32 charHeight;
 };
@@ -13,7 +14,39 @@ static BitmapFont s_font1;
 static BitmapFont s_bigFont0;
 static BitmapFont s_bigFont1;
 
-static void LoadBitmapFont(BitmapFont& font, f32 cw, f32 ch, std::string texture);
+// Laid out text is cached along with its glyph quads so labels drawn every frame don't get laid out again,
+// only text that changes (e.g. the live score) needs a new layout. The least recently used layout is reused
+// when the cache is full, the vectors keep their capacity so this doesn't allocate once warmed up.
+static constexpr s32 k_bitmapFontLayoutCacheSize = 32;
+static constexpr s32 k_bitmapFontLayoutLineReserve = 4;
+static constexpr s32 k_bitmapFontLayoutGlyphReserve = 32;
+
+struct BitmapFontGlyph
+{
+    s32 line;
+    f32 x1,y1,x2,y2; // Relative to the start of the line.
+    f32 s1,t1,s2,t2;
+};
+
+struct BitmapFontLayout
+{
+    const BitmapFont* font;
+    u32 hash;
+    u32 lastUsed;
+    f32 textureWidth;
+    f32 textureHeight;
+    std::string text;
+    std::vector<f32> lineOffsets; // Offset of each line from the first so that multi-line text is center aligned.
+    std::vector<BitmapFontGlyph> glyphs;
+};
+
+static BitmapFontLayout s_bitmapFontLayouts[k_bitmapFontLayoutCacheSize];
+static u32 s_bitmapFontLayoutTick;
+
+static void LoadBitmapFont(BitmapFont& font, f32 cw, f32 ch, const char* texture); // Keeps the texture resident until the font is freed.
+static void FreeBitmapFont(BitmapFont& font);
 static f32 GetCharWidth(BitmapFont& font, char c);
-static f32 GetTextLineWidth(BitmapFont& font, std::string text, s32 line = 0);
-static void DrawBitmapFont(BitmapFont& font, f32 x, f32 y, std::string text, nkVec4 color = { 1,1,1,1 });
+static f32 GetTextLineWidth(BitmapFont& font, std::string_view text, s32 line = 0);
+static void DrawBitmapFont(BitmapFont& font, f32 x, f32 y, std::string_view text, nkVec4 color = { 1,1,1,1 });
+
+static const BitmapFontLayout* GetBitmapFontLayout(BitmapFont& font, std::string_view text); // NULL if the font texture isn't loaded.
@@ -39,7 +39,7 @@ static void RenderCursor(f32 dt)
             nkVec2 pos = GetScreenMousePos();
             f32 x = roundf(pos.x);
             f32 y = roundf(pos.y);
-            imm::DrawTexture("cursor", x,y);
+            imm::DrawTexture(s_cursorTexture, x,y);
         }
     }
 }
@@ -50,7 +50,7 @@ static void RenderUnfocused(f32 dt)
     {
         f32 x = NK_CAST(f32, GetWindowWidth()/4);
         f32 y = NK_CAST(f32, GetWindowHeight()/4);
-        imm::DrawTexture("unfocused", x,y);
+        imm::DrawTexture(s_unfocusedTexture, x,y);
     }
 }
 
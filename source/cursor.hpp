@@ -1,3 +1,6 @@
+static AssetHandle<Texture> s_cursorTexture("cursor");
+static AssetHandle<Texture> s_unfocusedTexture("unfocused");
+
 static void UpdateCursor(f32 dt);
 static void RenderCursor(f32 dt);
 static void RenderUnfocused(f32 dt);
@@ -16,7 +16,8 @@ DEFINE_PRIVATE_STRUCT(VertexBuffer)
 DEFINE_PRIVATE_STRUCT(Shader)
 {
     std::string source;
-    GLuint program;
+    std::vector<std::string> keywords; // From the [Keywords] line, keyword N is bit (1 << N) of a variant.
+    std::vector<GLuint> variants; // Program for every combination of keywords, indexed by the keyword bits.
 };
 
 DEFINE_PRIVATE_STRUCT(Texture)
@@ -25,6 +26,7 @@ DEFINE_PRIVATE_STRUCT(Texture)
     f32 w, h;
     Filter filter;
     Wrap wrap;
+    size_t bytes; // Approximate VRAM used, for the asset budget.
 };
 
 DEFINE_PRIVATE_STRUCT(Framebuffer)
@@ -33,12 +35,54 @@ DEFINE_PRIVATE_STRUCT(Framebuffer)
     Texture texture = NULL; // Color Attachment
 };
 
+struct PaletteVariant
+{
+    s32 layout; // Row in the index texture, or -1 if the variant is stored in full color.
+    s32 direct; // Row in the full color texture, or -1 if the variant is indexed.
+};
+
+DEFINE_PRIVATE_STRUCT(PaletteTexture)
+{
+    Texture indices = NULL;  // Single channel index layouts stacked vertically.
+    Texture palettes = NULL; // One row of colors per variant.
+    Texture direct = NULL;   // Full color variants stacked vertically.
+    f32 variantW, variantH;
+    std::vector<PaletteVariant> variants;
+};
+
+// Must match the cooked format written by tools/packer.cpp.
+struct PaletteTextureHeader
+{
+    u32 magic;
+    u32 version;
+    u32 variantWidth;
+    u32 variantHeight;
+    u32 variantCount;
+    u32 layoutCount;
+    u32 directCount;
+    u32 payloadSize;
+};
+
+static constexpr u32 k_paletteTextureMagic = 0x58455450; // 'PTEX'
+static constexpr u32 k_paletteTextureVersion = 1;
+static constexpr u32 k_paletteSize = 256;
+
+// How the screen gets from its framebuffer into the window at the end of a frame.
+enum PresentMode
+{
+    PresentMode_Draw,   // Screen framebuffer is drawn to the window as a textured quad (needed for linear filtering).
+    PresentMode_Blit,   // Screen framebuffer is blitted to the window, used when scaling with nearest filtering.
+    PresentMode_Direct  // Screen is rendered straight into the window as it is 1:1, the screen framebuffer goes unused.
+};
+
 struct Screen
 {
     Framebuffer buffer;
     Rect bounds;
     ScaleMode scaleMode;
     Filter filter;
+    PresentMode presentMode;
+    bool rendered; // Whether a frame has been rendered since the last present.
 };
 
 struct Renderer
@@ -47,15 +91,25 @@ struct Renderer
     Rect viewport;
     Framebuffer boundTarget;
     Shader boundShader;
+    GLuint boundProgram; // Variant of the bound shader that is in use.
     Texture boundTexture[64];
     GLuint vao;
 };
 
+static constexpr size_t k_immVertexReserve = 16384;
+
 struct ImmContext
 {
     std::vector<imm::Vertex> verts;
     std::vector<nkMat4> transforms;
     Texture batchTexture;
+    Rect batchRegion; // Area of the batch texture that clips are relative to.
+    nkVec3 texUnits; // Written into every vertex by PutVertex.
+    s32 maxBatchTextures; // Units available to multi-texture batches, multi-texture batching is disabled if less than two.
+    s32 multiBatchTextureCount; // Units in use by the open multi-texture batch.
+    bool multiBatch; // Whether we're inside of BeginMultiTextureBatch and EndMultiTextureBatch.
+    bool multiBatchOpen; // Whether the multi-texture batch has been started and not flushed yet.
+    bool paletteDraw; // Whether any vertices in the current draw resolve against a palette.
     DrawMode drawMode;
     VertexBuffer vertBuffer;
     Shader shader;
@@ -63,13 +117,211 @@ struct ImmContext
     nkMat4 projectionMatrix;
     nkMat4 viewMatrix;
     nkMat4 modelMatrix;
-    bool alphaBlending;
     bool textureMapping;
 };
 
 static Renderer s_renderer;
 static ImmContext s_immContext;
 
+static AssetHandle<Shader> s_immDefaultShader("basic");
+
+static const nkVec3 k_immDefaultTexUnits = { 0.0f, -1.0f, 0.0f }; // Sample unit zero with no palette.
+
+static constexpr u32 k_maxShaderKeywords = 4; // Every combination gets built so keep this small.
+
+#ifndef __EMSCRIPTEN__
+// Linked shader programs are cached to disk so later launches can skip compiling and linking. Binaries are
+// only valid for the driver that produced them so the whole cache is thrown away if the driver changes, and
+// any binary the driver refuses to load just falls back to a full compile (which then replaces it).
+static constexpr u32 k_programBinaryCacheMagic = 0x48435250; // 'PRCH'
+static constexpr u32 k_programBinaryCacheVersion = 1;
+
+struct ProgramBinary
+{
+    u32 format;
+    std::vector<u8> data;
+};
+
+struct ProgramBinaryCache
+{
+    std::unordered_map<u64,ProgramBinary> programs; // Keyed by HashShaderSource.
+    std::unordered_set<u64> used; // Programs loaded or stored this session, anything else is stale.
+    std::string driver; // Vendor, renderer and version of the driver the binaries are for.
+    bool loaded;
+    bool supported;
+    bool dirty; // Stores are batched up and written out by FlushProgramBinaryCache.
+};
+
+static ProgramBinaryCache s_programBinaryCache;
+
+// 64-bit FNV-1a, a false match would load the wrong program so we want more bits than the asset hash.
+static u64 HashShaderSource(const std::string& source)
+{
+    u64 hash = 14695981039346656037ull;
+    for(char c: source) hash = (hash ^ NK_CAST(u8, c)) * 1099511628211ull;
+    return hash;
+}
+
+static std::string GetProgramBinaryCacheFileName()
+{
+    return GetExecPath() + "shaders.dat";
+}
+
+static void LoadProgramBinaryCache()
+{
+    ProgramBinaryCache& cache = s_programBinaryCache;
+    if(cache.loaded) return;
+    cache.loaded = true;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    cache.supported = (formats > 0 && glGetProgramBinary && glProgramBinary && glProgramParameteri);
+    if(!cache.supported) return;
+
+    cache.driver  = NK_CAST(const char*, glGetString(GL_VENDOR));
+    cache.driver += "\n";
+    cache.driver += NK_CAST(const char*, glGetString(GL_RENDERER));
+    cache.driver += "\n";
+    cache.driver += NK_CAST(const char*, glGetString(GL_VERSION));
+
+    std::vector<u8> file = ReadBinaryFile(GetProgramBinaryCacheFileName());
+    if(file.empty()) return;
+
+    size_t cursor = 0;
+    auto Read = [&](void* dst, size_t bytes)
+    {
+        if(cursor+bytes > file.size()) return false;
+        if(!bytes) return true;
+        memcpy(dst, &file[cursor], bytes);
+        cursor += bytes;
+        return true;
+    };
+
+    u32 magic = 0, version = 0, driverLength = 0;
+    if(!Read(&magic, sizeof(magic)) || !Read(&version, sizeof(version)) || !Read(&driverLength, sizeof(driverLength))) return;
+    if(magic != k_programBinaryCacheMagic || version != k_programBinaryCacheVersion) return;
+
+    std::string driver(driverLength, '\0');
+    if(!Read(&driver[0], driverLength)) return;
+    if(driver != cache.driver)
+    {
+        printf("Shader cache is for a different driver, shaders will be rebuilt!\n");
+        return;
+    }
+
+    u64 hash;
+    u32 format, size;
+    while(Read(&hash, sizeof(hash)) && Read(&format, sizeof(format)) && Read(&size, sizeof(size)))
+    {
+        ProgramBinary binary;
+        binary.format = format;
+        binary.data.resize(size);
+        if(!Read(binary.data.data(), size)) break;
+        cache.programs[hash] = std::move(binary);
+    }
+}
+
+static void SaveProgramBinaryCache()
+{
+    ProgramBinaryCache& cache = s_programBinaryCache;
+
+    std::vector<u8> file;
+    auto Write = [&](const void* src, size_t bytes)
+    {
+        file.insert(file.end(), NK_CAST(const u8*, src), NK_CAST(const u8*, src) + bytes);
+    };
+
+    u32 driverLength = NK_CAST(u32, cache.driver.size());
+    Write(&k_programBinaryCacheMagic, sizeof(k_programBinaryCacheMagic));
+    Write(&k_programBinaryCacheVersion, sizeof(k_programBinaryCacheVersion));
+    Write(&driverLength, sizeof(driverLength));
+    Write(cache.driver.data(), driverLength);
+
+    for(auto& [hash,binary]: cache.programs)
+    {
+        u32 size = NK_CAST(u32, binary.data.size());
+        Write(&hash, sizeof(hash));
+        Write(&binary.format, sizeof(binary.format));
+        Write(&size, sizeof(size));
+        Write(binary.data.data(), size);
+    }
+
+    WriteBinaryFile(GetProgramBinaryCacheFileName(), file.data(), file.size());
+}
+
+static bool LoadProgramBinary(GLuint& program, u64 hash)
+{
+    LoadProgramBinaryCache();
+
+    ProgramBinaryCache& cache = s_programBinaryCache;
+    if(!cache.supported) return false;
+    auto it = cache.programs.find(hash);
+    if(it == cache.programs.end()) return false;
+
+    program = glCreateProgram();
+    glProgramBinary(program, it->second.format, it->second.data.data(), NK_CAST(GLsizei, it->second.data.size()));
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glDeleteProgram(program);
+        program = GL_NONE;
+        cache.programs.erase(it);
+        cache.dirty = true;
+        return false;
+    }
+
+    cache.used.insert(hash);
+    return true;
+}
+
+static void StoreProgramBinary(GLuint program, u64 hash)
+{
+    ProgramBinaryCache& cache = s_programBinaryCache;
+    if(!cache.supported) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) return;
+
+    ProgramBinary binary;
+    binary.data.resize(length);
+    GLenum format = GL_NONE;
+    glGetProgramBinary(program, length, NULL, &format, binary.data.data());
+    binary.format = NK_CAST(u32, format);
+
+    cache.programs[hash] = std::move(binary);
+    cache.used.insert(hash);
+    cache.dirty = true;
+}
+
+// Called every frame so that all the programs built in a frame (e.g. when the assets load) get written at
+// once. Pruning entries that weren't used this session is left until quit, when all shaders have loaded.
+static void FlushProgramBinaryCache(bool prune)
+{
+    ProgramBinaryCache& cache = s_programBinaryCache;
+    if(!cache.supported) return;
+
+    if(prune)
+    {
+        for(auto it=cache.programs.begin(); it!=cache.programs.end();)
+        {
+            if(cache.used.count(it->first)) ++it;
+            else
+            {
+                it = cache.programs.erase(it);
+                cache.dirty = true;
+            }
+        }
+    }
+
+    if(!cache.dirty) return;
+    SaveProgramBinaryCache();
+    cache.dirty = false;
+}
+#endif // __EMSCRIPTEN__
+
 static GLuint CompileShader(std::string& source, GLenum type)
 {
     GLuint shader = glCreateShader(type);
@@ -92,6 +344,60 @@ static GLuint CompileShader(std::string& source, GLenum type)
     return shader;
 }
 
+// Defines go straight after the #version line as it has to come before anything else.
+static std::string AddShaderDefines(const std::string& source, const std::string& defines)
+{
+    size_t pos = 0;
+    size_t version = source.find("#version");
+    if(version != std::string::npos) pos = source.find('\n', version) + 1;
+    return source.substr(0, pos) + defines + source.substr(pos);
+}
+
+static GLuint BuildShaderProgram(std::string& vertSource, std::string& fragSource)
+{
+    #ifndef __EMSCRIPTEN__
+    u64 sourceHash = HashShaderSource(vertSource + fragSource);
+    GLuint cached = GL_NONE;
+    if(LoadProgramBinary(cached, sourceHash))
+        return cached;
+    #endif // __EMSCRIPTEN__
+
+    GLuint vert = CompileShader(vertSource, GL_VERTEX_SHADER);
+    GLuint frag = CompileShader(fragSource, GL_FRAGMENT_SHADER);
+
+    NK_DEFER(glDeleteShader(vert));
+    NK_DEFER(glDeleteShader(frag));
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vert);
+    glAttachShader(program, frag);
+    #ifndef __EMSCRIPTEN__
+    if(s_programBinaryCache.supported)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    #endif // __EMSCRIPTEN__
+    glLinkProgram(program);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        GLint infoLogLength;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+        std::string infoLog;
+        infoLog.resize(infoLogLength);
+        glGetProgramInfoLog(program, infoLogLength, NULL, &infoLog[0]);
+        printf("Failed to link shader:\n%s\n", infoLog.c_str());
+        glDeleteProgram(program);
+        return GL_NONE;
+    }
+
+    #ifndef __EMSCRIPTEN__
+    StoreProgramBinary(program, sourceHash);
+    #endif // __EMSCRIPTEN__
+
+    return program;
+}
+
 static bool CreateShader(Shader& shader, std::stringstream& stream)
 {
     shader = Allocate<GET_PTR_TYPE(shader)>(MEM_SYSTEM);
@@ -118,6 +424,14 @@ static bool CreateShader(Shader& shader, std::stringstream& stream)
         // Handle our attributes.
         if     (line.find("[VertProgram]") != std::string::npos) inVertProgram = true, inFragProgram = false;
         else if(line.find("[FragProgram]") != std::string::npos) inVertProgram = false, inFragProgram = true;
+        else if(line.find("[Keywords]") != std::string::npos)
+        {
+            // Keywords are whitespace separated names that get #defined for the variants that enable them.
+            std::stringstream keywords(line.substr(line.find("[Keywords]") + strlen("[Keywords]")));
+            std::string keyword;
+            while(keywords >> keyword)
+                shader->keywords.push_back(keyword);
+        }
         else
         {
             // Add lines to the appropriate shader sources.
@@ -126,28 +440,27 @@ static bool CreateShader(Shader& shader, std::stringstream& stream)
         }
     }
 
-    GLuint vert = CompileShader(vertSource, GL_VERTEX_SHADER);
-    GLuint frag = CompileShader(fragSource, GL_FRAGMENT_SHADER);
+    if(shader->keywords.size() > k_maxShaderKeywords)
+    {
+        printf("Shader has too many keywords (max %u)!\n", k_maxShaderKeywords);
+        return false;
+    }
 
-    NK_DEFER(glDeleteShader(vert));
-    NK_DEFER(glDeleteShader(frag));
+    // Build every combination of keywords up-front so that nothing ever has to be compiled mid-frame.
+    u32 variantCount = 1 << shader->keywords.size();
+    for(u32 keywordBits=0; keywordBits<variantCount; ++keywordBits)
+    {
+        std::string defines;
+        for(size_t i=0; i<shader->keywords.size(); ++i)
+            if(keywordBits & (1 << i))
+                defines += "#define " + shader->keywords[i] + "\n";
 
-    shader->program = glCreateProgram();
-    glAttachShader(shader->program, vert);
-    glAttachShader(shader->program, frag);
-    glLinkProgram(shader->program);
+        std::string variantVertSource = AddShaderDefines(vertSource, defines);
+        std::string variantFragSource = AddShaderDefines(fragSource, defines);
 
-    GLint success;
-    glGetProgramiv(shader->program, GL_LINK_STATUS, &success);
-    if(!success)
-    {
-        GLint infoLogLength;
-        glGetProgramiv(shader->program, GL_INFO_LOG_LENGTH, &infoLogLength);
-        std::string infoLog;
-        infoLog.resize(infoLogLength);
-        glGetProgramInfoLog(shader->program, infoLogLength, NULL, &infoLog[0]);
-        printf("Failed to link shader:\n%s\n", infoLog.c_str());
-        return false;
+        GLuint program = BuildShaderProgram(variantVertSource, variantFragSource);
+        if(!program) return false;
+        shader->variants.push_back(program);
     }
 
     return true;
@@ -157,6 +470,7 @@ static GLenum BPPToGLFormat(s32 bpp)
 {
     switch(bpp)
     {
+        case 1: return GL_RED; break;
         case 3: return GL_RGB; break;
         case 4: return GL_RGBA; break;
         default:
@@ -167,6 +481,23 @@ static GLenum BPPToGLFormat(s32 bpp)
     return GL_NONE;
 }
 
+static void PremultiplyAlpha(u8* pixels, size_t pixelCount)
+{
+    for(size_t i=0; i<pixelCount; ++i, pixels+=4)
+    {
+        u32 a = pixels[3];
+        pixels[0] = NK_CAST(u8, (pixels[0] * a + 127) / 255);
+        pixels[1] = NK_CAST(u8, (pixels[1] * a + 127) / 255);
+        pixels[2] = NK_CAST(u8, (pixels[2] * a + 127) / 255);
+    }
+}
+
+static GLenum BPPToGLInternalFormat(s32 bpp)
+{
+    if(bpp == 1) return GL_R8;
+    return BPPToGLFormat(bpp);
+}
+
 static Filter StringToFilter(const std::string& str)
 {
     if(str == "nearest") return Filter_Nearest;
@@ -235,10 +566,32 @@ static bool LoadShaderFromData(Shader& shader, void* data, size_t bytes)
     return CreateShader(shader, stream);
 }
 
+static bool ReloadShaderFromFile(Shader& shader, std::string fileName)
+{
+    // Build into a temporary shader first so that a broken edit doesn't leave us with nothing to draw with.
+    Shader reloaded = NULL;
+    if(!LoadShaderFromFile(reloaded, fileName))
+    {
+        FreeShader(reloaded);
+        return false;
+    }
+
+    // Move the new programs into the existing handle so anything holding it sees the change.
+    for(GLuint program: shader->variants)
+        glDeleteProgram(program);
+    shader->variants = std::move(reloaded->variants);
+    shader->keywords = std::move(reloaded->keywords);
+    shader->source = std::move(reloaded->source);
+    Deallocate(reloaded);
+
+    return true;
+}
+
 static void FreeShader(Shader& shader)
 {
     if(!shader) return;
-    glDeleteProgram(shader->program);
+    for(GLuint program: shader->variants)
+        glDeleteProgram(program);
     Deallocate(shader);
 }
 
@@ -263,12 +616,16 @@ static bool CreateTexture(Texture& texture, s32 w, s32 h, s32 bpp, void* data, F
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FilterToGLFilter(filter));
 
     GLenum glFormat = BPPToGLFormat(bpp);
-    glTexImage2D(GL_TEXTURE_2D, 0, glFormat, w,h, 0, glFormat, GL_UNSIGNED_BYTE, data);
+    GLenum glInternalFormat = BPPToGLInternalFormat(bpp);
+    if(bpp != 4) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, glInternalFormat, w,h, 0, glFormat, GL_UNSIGNED_BYTE, data);
+    if(bpp != 4) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     texture->w = NK_CAST(f32, w);
     texture->h = NK_CAST(f32, h);
     texture->wrap = wrap;
     texture->filter = filter;
+    texture->bytes = NK_CAST(size_t, w) * NK_CAST(size_t, h) * NK_CAST(size_t, bpp);
 
     return true;
 }
@@ -283,6 +640,7 @@ static bool LoadTextureFromFile(Texture& texture, std::string fileName, Filter f
     else
     {
         NK_DEFER(stbi_image_free(rawData));
+        PremultiplyAlpha(rawData, width*height);
         return CreateTexture(texture, width,height,k_bytesPerPixel, rawData, filter, wrap);
     }
     return false;
@@ -298,11 +656,29 @@ static bool LoadTextureFromData(Texture& texture, void* data, size_t bytes, Filt
     else
     {
         NK_DEFER(stbi_image_free(rawData));
+        PremultiplyAlpha(rawData, width*height);
         return CreateTexture(texture, width,height,k_bytesPerPixel, rawData, filter, wrap);
     }
     return false;
 }
 
+static bool ReloadTextureFromFile(Texture& texture, std::string fileName)
+{
+    Texture reloaded = NULL;
+    if(!LoadTextureFromFile(reloaded, fileName, texture->filter, texture->wrap))
+        return false;
+
+    // Move the new image into the existing handle so anything holding it sees the change.
+    glDeleteTextures(1, &texture->handle);
+    texture->handle = reloaded->handle;
+    texture->w = reloaded->w;
+    texture->h = reloaded->h;
+    texture->bytes = reloaded->bytes;
+    Deallocate(reloaded);
+
+    return true;
+}
+
 static void FreeTexture(Texture& texture)
 {
     if(!texture) return;
@@ -330,6 +706,158 @@ static void SetTextureWrap(Texture& texture, Wrap wrap)
     texture->wrap = wrap;
 }
 
+static Filter GetTextureFilter(const Texture& texture)
+{
+    return texture->filter;
+}
+
+static Wrap GetTextureWrap(const Texture& texture)
+{
+    return texture->wrap;
+}
+
+static size_t GetTextureBytes(const Texture& texture)
+{
+    return (texture) ? texture->bytes : 0;
+}
+
+//
+// PaletteTexture
+//
+
+static bool LoadPaletteTextureFromFile(PaletteTexture& texture, std::string fileName)
+{
+    std::vector<u8> data = ReadBinaryFile(fileName);
+    if(data.empty())
+    {
+        printf("Failed to load palette texture from file '%s'!\n", fileName.c_str());
+        return false;
+    }
+    return LoadPaletteTextureFromData(texture, &data[0], data.size());
+}
+
+static bool LoadPaletteTextureFromData(PaletteTexture& texture, void* data, size_t bytes)
+{
+    PaletteTextureHeader header;
+    if(bytes < sizeof(header))
+    {
+        printf("Failed to load palette texture from data!\n");
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != k_paletteTextureMagic || header.version != k_paletteTextureVersion)
+    {
+        printf("Failed to load palette texture from data, unknown format or version!\n");
+        return false;
+    }
+
+    if(header.variantCount == 0)
+    {
+        printf("Failed to load palette texture from data, no variants!\n");
+        return false;
+    }
+
+    size_t tableBytes = NK_CAST(size_t, header.variantCount) * sizeof(PaletteVariant);
+    if(bytes < sizeof(header) + tableBytes)
+    {
+        printf("Failed to load palette texture from data!\n");
+        return false;
+    }
+
+    u8* compressed = NK_CAST(u8*, data) + sizeof(header) + tableBytes;
+    s32 compressedSize = NK_CAST(s32, bytes - sizeof(header) - tableBytes);
+    s32 payloadSize = 0;
+    u8* payload = NK_CAST(u8*, stbi_zlib_decode_malloc(NK_CAST(const char*, compressed), compressedSize, &payloadSize));
+    if(!payload)
+    {
+        printf("Failed to load palette texture from data, payload failed to decompress!\n");
+        return false;
+    }
+    NK_DEFER(stbi_image_free(payload));
+
+    size_t variantBytes = NK_CAST(size_t, header.variantWidth) * header.variantHeight;
+    size_t indexBytes = NK_CAST(size_t, header.layoutCount) * variantBytes;
+    size_t paletteBytes = NK_CAST(size_t, header.variantCount) * k_paletteSize * 4;
+    size_t directBytes = NK_CAST(size_t, header.directCount) * variantBytes * 4;
+    if(NK_CAST(size_t, payloadSize) != header.payloadSize || header.payloadSize != indexBytes + paletteBytes + directBytes)
+    {
+        printf("Failed to load palette texture from data, payload is corrupt!\n");
+        return false;
+    }
+
+    texture = Allocate<GET_PTR_TYPE(texture)>(MEM_SYSTEM);
+    if(!texture)
+        FatalError("Failed to allocate palette texture!\n");
+
+    texture->variantW = NK_CAST(f32, header.variantWidth);
+    texture->variantH = NK_CAST(f32, header.variantHeight);
+    texture->variants.resize(header.variantCount);
+    memcpy(&texture->variants[0], NK_CAST(u8*, data) + sizeof(header), tableBytes);
+
+    s32 w = NK_CAST(s32, header.variantWidth);
+    s32 h = NK_CAST(s32, header.variantHeight);
+
+    PremultiplyAlpha(payload + indexBytes, paletteBytes / 4);
+    PremultiplyAlpha(payload + indexBytes + paletteBytes, directBytes / 4);
+
+    // The index texture can't be filtered by the hardware, instead the shader filters after the palette lookup.
+    if(header.layoutCount)
+        CreateTexture(texture->indices, w, h * header.layoutCount, 1, payload, Filter_Nearest, Wrap_Clamp);
+    CreateTexture(texture->palettes, k_paletteSize, header.variantCount, 4, payload + indexBytes, Filter_Nearest, Wrap_Clamp);
+    if(header.directCount)
+        CreateTexture(texture->direct, w, h * header.directCount, 4, payload + indexBytes + paletteBytes, Filter_Linear, Wrap_Clamp);
+
+    return true;
+}
+
+static bool ReloadPaletteTextureFromFile(PaletteTexture& texture, std::string fileName)
+{
+    PaletteTexture reloaded = NULL;
+    if(!LoadPaletteTextureFromFile(reloaded, fileName))
+        return false;
+
+    // Swap the new data into the existing handle so anything holding it sees the change.
+    std::swap(texture->indices, reloaded->indices);
+    std::swap(texture->palettes, reloaded->palettes);
+    std::swap(texture->direct, reloaded->direct);
+    std::swap(texture->variants, reloaded->variants);
+    texture->variantW = reloaded->variantW;
+    texture->variantH = reloaded->variantH;
+    FreePaletteTexture(reloaded);
+
+    return true;
+}
+
+static void FreePaletteTexture(PaletteTexture& texture)
+{
+    if(!texture) return;
+    FreeTexture(texture->indices);
+    FreeTexture(texture->palettes);
+    FreeTexture(texture->direct);
+    Deallocate(texture);
+}
+
+static f32 GetPaletteTextureVariantWidth(PaletteTexture& texture)
+{
+    return texture->variantW;
+}
+
+static f32 GetPaletteTextureVariantHeight(PaletteTexture& texture)
+{
+    return texture->variantH;
+}
+
+static s32 GetPaletteTextureVariantCount(PaletteTexture& texture)
+{
+    return NK_CAST(s32, texture->variants.size());
+}
+
+static size_t GetPaletteTextureBytes(const PaletteTexture& texture)
+{
+    if(!texture) return 0;
+    return GetTextureBytes(texture->indices) + GetTextureBytes(texture->palettes) + GetTextureBytes(texture->direct);
+}
+
 //
 // VertexBuffer
 //
@@ -501,15 +1029,20 @@ static void InitGraphics()
 
     s_renderer.screen.scaleMode = ScaleMode_Letterbox;
     s_renderer.screen.filter = Filter_Linear;
+    s_renderer.screen.presentMode = PresentMode_Draw;
     CreateFramebuffer(s_renderer.screen.buffer, width,height, s_renderer.screen.filter);
     imm::CreateContext();
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // Everything is premultiplied (see imm::PremultiplyColor).
     glEnable(GL_BLEND);
 }
 
 static void QuitGraphics()
 {
+    #ifndef __EMSCRIPTEN__
+    FlushProgramBinaryCache(true);
+    #endif // __EMSCRIPTEN__
+
     imm::FreeContext();
     FreeFramebuffer(s_renderer.screen.buffer);
 
@@ -520,6 +1053,13 @@ static void QuitGraphics()
 
 static void BeginRenderFrame()
 {
+    ResetFrameArena();
+    BeginAssetFrame();
+
+    #ifndef __EMSCRIPTEN__
+    FlushProgramBinaryCache(false);
+    #endif // __EMSCRIPTEN__
+
     f32 windowWidth = NK_CAST(f32, GetWindowWidth());
     f32 windowHeight = NK_CAST(f32, GetWindowHeight());
     f32 screenWidth = s_renderer.screen.buffer->texture->w;
@@ -599,32 +1139,65 @@ static void BeginRenderFrame()
     screenWidth = s_renderer.screen.buffer->texture->w;
     screenHeight = s_renderer.screen.buffer->texture->h;
 
+    // Work out the cheapest way of getting the screen into the window. If the screen lands on the window's
+    // pixel grid at 1:1 we can skip the screen framebuffer and render directly, otherwise if no filtering is
+    // needed a blit saves drawing the screen through the imm shader.
+    bool unscaled = (w == screenWidth && h == screenHeight && x == floorf(x) && y == floorf(y));
+    if(unscaled) s_renderer.screen.presentMode = PresentMode_Direct;
+    else if(s_renderer.screen.filter == Filter_Nearest) s_renderer.screen.presentMode = PresentMode_Blit;
+    else s_renderer.screen.presentMode = PresentMode_Draw;
+
+    s_renderer.screen.rendered = true;
+
     Rect viewport = { 0,0,screenWidth,screenHeight };
-    SetRenderTarget(s_renderer.screen.buffer);
+    SetRenderTarget(NULL);
     SetViewport(&viewport);
     s_immContext.projectionMatrix = nk_orthographic(0.0f,screenWidth,screenHeight,0.0f,0.0f,1.0f);
 }
 
-static void EndRenderFrame()
+static bool EndRenderFrame()
 {
     f32 ww = NK_CAST(f32,GetWindowWidth());
     f32 wh = NK_CAST(f32,GetWindowHeight());
 
+    bool direct = (s_renderer.screen.presentMode == PresentMode_Direct);
+
+    // When rendering directly the last frame only exists in the window, so if nothing new has been rendered
+    // there is nothing we can present and the caller should just not swap.
+    if(direct && !s_renderer.screen.rendered) return false;
+    s_renderer.screen.rendered = false;
+
+    SetRenderTarget(NULL);
+
     glColorMask(false,false,false,true);
     glClearColor(0,0,0,1);
     glClear(GL_COLOR_BUFFER_BIT);
     glColorMask(true,true,true,true);
 
     glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+    glDisable(GL_SCISSOR_TEST);
 
-    Rect viewport = { 0,0,ww,wh };
-    SetViewport(&viewport);
+    if(direct) return true;
 
     f32 dstX0 = s_renderer.screen.bounds.x;
     f32 dstY0 = s_renderer.screen.bounds.y;
     f32 dstX1 = s_renderer.screen.bounds.w + dstX0;
     f32 dstY1 = s_renderer.screen.bounds.h + dstY0;
 
+    if(s_renderer.screen.presentMode == PresentMode_Blit)
+    {
+        // The screen bounds are top-down whereas GL windows have their origin at the bottom-left.
+        GLint sw = NK_CAST(GLint, s_renderer.screen.buffer->texture->w);
+        GLint sh = NK_CAST(GLint, s_renderer.screen.buffer->texture->h);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, s_renderer.screen.buffer->handle);
+        glBlitFramebuffer(0,0,sw,sh, NK_CAST(GLint,dstX0),NK_CAST(GLint,wh-dstY1),NK_CAST(GLint,dstX1),NK_CAST(GLint,wh-dstY0), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+        return true;
+    }
+
+    Rect viewport = { 0,0,ww,wh };
+    SetViewport(&viewport);
+
     auto& projection = imm::GetProjectionMatrix();
     auto& view = imm::GetViewMatrix();
     auto& model = imm::GetModelMatrix();
@@ -634,27 +1207,51 @@ static void EndRenderFrame()
     model = nk_m4_identity();
 
     imm::DrawFramebuffer(s_renderer.screen.buffer, dstX0,dstY0,dstX1,dstY1);
+
+    return true;
+}
+
+static bool CanPresentLastFrame()
+{
+    return (s_renderer.screen.presentMode != PresentMode_Direct);
 }
 
 static void Clear(f32 r, f32 g, f32 b, f32 a)
 {
+    imm::FlushMultiTextureBatch();
     glClearColor(r,g,b,a);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 static void Clear(nkVec4 color)
 {
+    imm::FlushMultiTextureBatch();
     glClearColor(color.r,color.g,color.b,color.a);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 static void SetRenderTarget(Framebuffer target)
 {
+    imm::FlushMultiTextureBatch();
     s_renderer.boundTarget = target;
     if(!target)
-        glBindFramebuffer(GL_FRAMEBUFFER, s_renderer.screen.buffer->handle);
+    {
+        if(s_renderer.screen.presentMode != PresentMode_Direct)
+            glBindFramebuffer(GL_FRAMEBUFFER, s_renderer.screen.buffer->handle);
+        else
+        {
+            // The window is bigger than the screen so keep clears and draws inside the screen's bounds.
+            Rect bounds = s_renderer.screen.bounds;
+            glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+            glScissor(NK_CAST(GLint,bounds.x), NK_CAST(GLint,GetWindowHeight()-(bounds.y+bounds.h)), NK_CAST(GLsizei,bounds.w), NK_CAST(GLsizei,bounds.h));
+            glEnable(GL_SCISSOR_TEST);
+        }
+    }
     else
+    {
         glBindFramebuffer(GL_FRAMEBUFFER, target->handle);
+        glDisable(GL_SCISSOR_TEST);
+    }
 }
 
 static void SetViewport(Rect* viewport)
@@ -662,6 +1259,8 @@ static void SetViewport(Rect* viewport)
     GLint x,y;
     GLsizei w,h;
 
+    imm::FlushMultiTextureBatch();
+
     if(viewport) s_renderer.viewport = *viewport;
     else s_renderer.viewport = { 0,0,NK_CAST(f32,GetRenderTargetWidth()),NK_CAST(f32,GetRenderTargetHeight()) };
 
@@ -670,6 +1269,13 @@ static void SetViewport(Rect* viewport)
     w = NK_CAST(GLsizei, s_renderer.viewport.w);
     h = NK_CAST(GLsizei, s_renderer.viewport.h);
 
+    // When rendering directly to the window the screen is somewhere inside of it rather than at the origin.
+    if(!s_renderer.boundTarget && s_renderer.screen.presentMode == PresentMode_Direct)
+    {
+        x += NK_CAST(GLint, s_renderer.screen.bounds.x);
+        y += NK_CAST(GLint, GetWindowHeight()-(s_renderer.screen.bounds.y+s_renderer.screen.bounds.h));
+    }
+
     glViewport(x,y,w,h);
 }
 
@@ -748,11 +1354,23 @@ static void UseShader(std::string shaderName)
     }
 }
 
-static void UseShader(Shader shader)
+static void UseShader(Shader shader, u32 keywords)
 {
-    if(!shader) glUseProgram(GL_NONE);
-    else glUseProgram(shader->program);
+    GLuint program = GL_NONE;
+    if(shader && !shader->variants.empty())
+        program = shader->variants[keywords & (shader->variants.size()-1)];
+    glUseProgram(program);
     s_renderer.boundShader = shader;
+    s_renderer.boundProgram = program;
+}
+
+static u32 GetShaderKeyword(Shader shader, std::string keyword)
+{
+    if(!shader) return 0;
+    for(size_t i=0; i<shader->keywords.size(); ++i)
+        if(shader->keywords[i] == keyword)
+            return (1 << i);
+    return 0;
 }
 
 static void UseTexture(std::string textureName, s32 unit)
@@ -788,7 +1406,7 @@ static void SetShaderBool(std::string name, bool val)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform1i(location, NK_CAST(s32, val));
 }
@@ -796,15 +1414,31 @@ static void SetShaderInt(std::string name, s32 val)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform1i(location, val);
 }
+static void SetShaderIntArray(std::string name, const s32* vals, s32 count)
+{
+    ASSERT(s_renderer.boundShader, "No shader is currently bound!");
+    if(!s_renderer.boundShader) return;
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
+    if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
+    glUniform1iv(location, count, vals);
+}
+static void SetShaderFloatArray(std::string name, const f32* vals, s32 count)
+{
+    ASSERT(s_renderer.boundShader, "No shader is currently bound!");
+    if(!s_renderer.boundShader) return;
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
+    if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
+    glUniform1fv(location, count, vals);
+}
 static void SetShaderFloat(std::string name, f32 val)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform1f(location, val);
 }
@@ -812,7 +1446,7 @@ static void SetShaderVec2(std::string name, nkVec2 vec)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform2fv(location, 1, vec.raw);
 }
@@ -820,7 +1454,7 @@ static void SetShaderVec3(std::string name, nkVec3 vec)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform3fv(location, 1, vec.raw);
 }
@@ -828,7 +1462,7 @@ static void SetShaderVec4(std::string name, nkVec4 vec)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniform4fv(location, 1, vec.raw);
 }
@@ -836,7 +1470,7 @@ static void SetShaderMat2(std::string name, nkMat2 mat)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniformMatrix2fv(location, 1, GL_FALSE, mat.raw);
 }
@@ -844,7 +1478,7 @@ static void SetShaderMat3(std::string name, nkMat3 mat)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniformMatrix3fv(location, 1, GL_FALSE, mat.raw);
 }
@@ -852,7 +1486,7 @@ static void SetShaderMat4(std::string name, nkMat4 mat)
 {
     ASSERT(s_renderer.boundShader, "No shader is currently bound!");
     if(!s_renderer.boundShader) return;
-    GLint location = glGetUniformLocation(s_renderer.boundShader->program, name.c_str());
+    GLint location = glGetUniformLocation(s_renderer.boundProgram, name.c_str());
     if(location == -1) printf("No shader uniform found: %s\n", name.c_str());
     glUniformMatrix4fv(location, 1, GL_FALSE, mat.raw);
 }
@@ -873,9 +1507,19 @@ namespace imm
         EnableVertexBufferAttrib(s_immContext.vertBuffer, 0, AttribType_Float, 4, offsetof(Vertex, position));
         EnableVertexBufferAttrib(s_immContext.vertBuffer, 1, AttribType_Float, 4, offsetof(Vertex, color));
         EnableVertexBufferAttrib(s_immContext.vertBuffer, 2, AttribType_Float, 2, offsetof(Vertex, texCoord));
+        EnableVertexBufferAttrib(s_immContext.vertBuffer, 3, AttribType_Float, 3, offsetof(Vertex, texUnits));
+
+        // Reserve up-front so the vertex list doesn't keep growing on the heap during the first frames.
+        s_immContext.verts.reserve(k_immVertexReserve);
 
-        s_immContext.alphaBlending = true;
         s_immContext.textureMapping = false;
+        s_immContext.texUnits = k_immDefaultTexUnits;
+
+        // GL 3.3 and ES 3.0 guarantee sixteen fragment units but don't rely on it, with less than two units there's
+        // nothing to gain so multi-texture batches just fall back to drawing each texture batch separately.
+        GLint textureUnits = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+        s_immContext.maxBatchTextures = std::min(NK_CAST(s32, textureUnits), k_maxBatchTextures);
 
         s_immContext.projectionMatrix = nk_orthographic(0.0f,w,h,0.0f,0.0f,1.0f);
         s_immContext.viewMatrix = nk_m4_identity();
@@ -966,8 +1610,30 @@ namespace imm
         DrawTexture(texture, x, y, sx, sy, angle, flip, anchor, clip, color);
     }
 
+    static void DrawTexture(AssetHandle<Texture>& textureHandle, f32 x, f32 y, const Rect* clip, nkVec4 color)
+    {
+        Texture* texture = GetAsset(textureHandle);
+        if(!texture || !*texture) return;
+        DrawTexture(*texture, x, y, clip, color);
+    }
+
+    static void DrawTexture(AssetHandle<Texture>& textureHandle, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
+    {
+        Texture* texture = GetAsset(textureHandle);
+        if(!texture || !*texture) return;
+        DrawTexture(*texture, x, y, sx, sy, angle, flip, anchor, clip, color);
+    }
+
     static void DrawTexture(Texture& texture, f32 x, f32 y, const Rect* clip, nkVec4 color)
     {
+        if(s_immContext.multiBatch)
+        {
+            BeginTextureBatch(texture);
+            DrawBatchedTexture(x, y, clip, color);
+            EndTextureBatch();
+            return;
+        }
+
         f32 s1 = 0;
         f32 t1 = 0;
         f32 s2 = texture->w;
@@ -1009,6 +1675,14 @@ namespace imm
 
     static void DrawTexture(Texture& texture, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
     {
+        if(s_immContext.multiBatch)
+        {
+            BeginTextureBatch(texture);
+            DrawBatchedTexture(x, y, sx, sy, angle, flip, anchor, clip, color);
+            EndTextureBatch();
+            return;
+        }
+
         f32 s1 = 0;
         f32 t1 = 0;
         f32 s2 = texture->w;
@@ -1071,6 +1745,96 @@ namespace imm
         modelMatrix = cachedMatrix;
     }
 
+    // Works out where in the palette texture a variant lives, the palette is set to NULL if the variant isn't indexed.
+    static Texture GetPaletteVariant(PaletteTexture& texture, s32 variant, Rect& region, Texture& palette)
+    {
+        ASSERT(variant >= 0 && variant < GetPaletteTextureVariantCount(texture), "Palette texture variant out of range!");
+        const PaletteVariant& v = texture->variants[variant];
+        s32 row = (v.layout >= 0) ? v.layout : v.direct;
+        region = { 0.0f, texture->variantH * NK_CAST(f32, row), texture->variantW, texture->variantH };
+        palette = (v.layout >= 0) ? texture->palettes : NULL;
+        return (v.layout >= 0) ? texture->indices : texture->direct;
+    }
+
+    static s32 GetMultiTextureBatchUnit(Texture texture)
+    {
+        for(s32 i=0; i<s_immContext.multiBatchTextureCount; ++i)
+            if(s_immContext.texture[i] == texture)
+                return i;
+        return -1;
+    }
+
+    static s32 AddMultiTextureBatchUnit(Texture texture)
+    {
+        s32 unit = GetMultiTextureBatchUnit(texture);
+        if(unit >= 0) return unit;
+        ASSERT(s_immContext.multiBatchTextureCount < s_immContext.maxBatchTextures, "Multi-texture batch is out of units!");
+        unit = s_immContext.multiBatchTextureCount++;
+        s_immContext.texture[unit] = texture;
+        return unit;
+    }
+
+    // Sets up the textures for a texture batch (the palette is optional), when inside of a multi-texture batch this
+    // finds them units in the open multi-texture batch instead of starting a new draw, flushing if none are left.
+    static void BeginBatchTextures(Texture texture, Texture palette, s32 paletteRow)
+    {
+        if(!s_immContext.multiBatch)
+        {
+            SetCurrentTexture(texture, 0);
+            SetCurrentTexture(palette, 1);
+            s_immContext.texUnits = { 0.0f, (palette) ? 1.0f : -1.0f, NK_CAST(f32, paletteRow) };
+            BeginDraw(DrawMode_Triangles);
+            s_immContext.paletteDraw = (palette != NULL);
+            return;
+        }
+
+        s32 unitsNeeded = 0;
+        if(GetMultiTextureBatchUnit(texture) < 0) unitsNeeded++;
+        if(palette && GetMultiTextureBatchUnit(palette) < 0) unitsNeeded++;
+        if(s_immContext.multiBatchTextureCount+unitsNeeded > s_immContext.maxBatchTextures)
+            FlushMultiTextureBatch();
+
+        if(!s_immContext.multiBatchOpen)
+        {
+            for(s32 i=0; i<k_maxBatchTextures; ++i)
+                s_immContext.texture[i] = NULL;
+            BeginDraw(DrawMode_Triangles);
+            s_immContext.multiBatchOpen = true;
+        }
+
+        s32 unit = AddMultiTextureBatchUnit(texture);
+        s32 paletteUnit = (palette) ? AddMultiTextureBatchUnit(palette) : -1;
+        s_immContext.texUnits = { NK_CAST(f32, unit), NK_CAST(f32, paletteUnit), NK_CAST(f32, paletteRow) };
+        if(palette) s_immContext.paletteDraw = true;
+    }
+
+    static void EndBatchTextures()
+    {
+        s_immContext.texUnits = k_immDefaultTexUnits;
+        if(s_immContext.multiBatch) return;
+
+        bool textureMapping = s_immContext.textureMapping;
+        s_immContext.textureMapping = true;
+        EndDraw();
+        SetCurrentTexture(NULL, 0);
+        SetCurrentTexture(NULL, 1);
+        s_immContext.textureMapping = textureMapping;
+    }
+
+    static void DrawPaletteTexture(AssetHandle<PaletteTexture>& textureHandle, s32 variant, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
+    {
+        PaletteTexture* texture = GetAsset(textureHandle);
+        if(!texture || !*texture) return;
+        DrawPaletteTexture(*texture, variant, x, y, sx, sy, angle, flip, anchor, clip, color);
+    }
+
+    static void DrawPaletteTexture(PaletteTexture& texture, s32 variant, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
+    {
+        BeginPaletteTextureBatch(texture, variant);
+        DrawBatchedTexture(x, y, sx, sy, angle, flip, anchor, clip, color);
+        EndTextureBatch();
+    }
+
     static void DrawFramebuffer(Framebuffer& framebuffer, f32 dstX0, f32 dstY0, f32 dstX1, f32 dstY1)
     {
         bool textureMapping = s_immContext.textureMapping;
@@ -1090,12 +1854,11 @@ namespace imm
 
     static void BeginDraw(DrawMode drawMode)
     {
+        FlushMultiTextureBatch();
+
         s_immContext.verts.clear();
         s_immContext.drawMode = drawMode;
-
-        // Set shader.
-        if(!s_immContext.shader) UseShader("basic");
-        else UseShader(s_immContext.shader);
+        s_immContext.paletteDraw = false;
 
         // Set texture.
         for(s32 i=0; i<64; ++i)
@@ -1105,12 +1868,35 @@ namespace imm
 
     static void EndDraw()
     {
+        // Set shader. Texture mapping is only known for sure once the draw ends so the variant is picked here,
+        // custom shaders only need to declare the keywords they care about as missing ones are just ignored.
+        Shader shader = s_immContext.shader;
+        if(!shader)
+        {
+            Shader* defaultShader = GetAsset(s_immDefaultShader);
+            shader = (defaultShader) ? *defaultShader : NULL;
+        }
+        u32 keywords = 0;
+        if(s_immContext.textureMapping)
+        {
+            keywords |= GetShaderKeyword(shader, "TEXTURED");
+            if(s_immContext.paletteDraw)
+                keywords |= GetShaderKeyword(shader, "PALETTE");
+        }
+        UseShader(shader, keywords);
+
         // Set uniforms.
         SetShaderMat4("u_projectionMatrix", s_immContext.projectionMatrix);
         SetShaderMat4("u_viewMatrix", s_immContext.viewMatrix);
         SetShaderMat4("u_modelMatrix", s_immContext.modelMatrix);
-        SetShaderBool("u_textureMapping", s_immContext.textureMapping);
-        SetShaderInt ("u_texture0", 0);
+
+        if(s_immContext.textureMapping)
+        {
+            s32 units[k_maxBatchTextures];
+            for(s32 i=0; i<k_maxBatchTextures; ++i)
+                units[i] = (i < s_immContext.maxBatchTextures) ? i : 0;
+            SetShaderIntArray("u_textures", units, k_maxBatchTextures);
+        }
 
         // Draw stuff.
         UpdateVertexBuffer(s_immContext.vertBuffer, &s_immContext.verts[0], s_immContext.verts.size()*sizeof(Vertex), BufferType_Dynamic);
@@ -1119,9 +1905,18 @@ namespace imm
 
     static void PutVertex(Vertex v)
     {
+        v.texUnits = s_immContext.texUnits;
         s_immContext.verts.push_back(v);
     }
 
+    static void PutVertices(const Vertex* verts, size_t count)
+    {
+        size_t start = s_immContext.verts.size();
+        s_immContext.verts.insert(s_immContext.verts.end(), verts, verts+count);
+        for(size_t i=start; i<s_immContext.verts.size(); ++i)
+            s_immContext.verts[i].texUnits = s_immContext.texUnits;
+    }
+
     static void BeginTextureBatch(std::string textureName)
     {
         Texture texture = *GetAsset<Texture>(textureName);
@@ -1129,33 +1924,88 @@ namespace imm
         BeginTextureBatch(texture);
     }
 
+    static void BeginTextureBatch(AssetHandle<Texture>& textureHandle)
+    {
+        Texture* texture = GetAsset(textureHandle);
+        if(!texture || !*texture) return;
+        BeginTextureBatch(*texture);
+    }
+
     static void BeginTextureBatch(Texture& texture)
     {
         s_immContext.batchTexture = texture;
-        SetCurrentTexture(texture);
-        BeginDraw(DrawMode_Triangles);
+        s_immContext.batchRegion = { 0.0f, 0.0f, texture->w, texture->h };
+        BeginBatchTextures(texture, NULL, 0);
+    }
+
+    static void BeginPaletteTextureBatch(AssetHandle<PaletteTexture>& textureHandle, s32 variant)
+    {
+        PaletteTexture* texture = GetAsset(textureHandle);
+        if(!texture || !*texture) return;
+        BeginPaletteTextureBatch(*texture, variant);
+    }
+
+    static void BeginPaletteTextureBatch(PaletteTexture& texture, s32 variant)
+    {
+        Rect region;
+        Texture palette;
+        Texture sheet = GetPaletteVariant(texture, variant, region, palette);
+        s_immContext.batchTexture = sheet;
+        s_immContext.batchRegion = region;
+        BeginBatchTextures(sheet, palette, variant);
     }
 
     static void EndTextureBatch()
     {
-        bool textureMapping = s_immContext.textureMapping;
-        s_immContext.textureMapping = true;
-        EndDraw();
-        SetCurrentTexture(NULL);
-        s_immContext.textureMapping = textureMapping;
+        EndBatchTextures();
+    }
+
+    static void BeginMultiTextureBatch()
+    {
+        ASSERT(!s_immContext.multiBatch, "Already inside of a multi-texture batch!");
+        s_immContext.multiBatch = (s_immContext.maxBatchTextures >= 2);
+    }
+
+    static void EndMultiTextureBatch()
+    {
+        FlushMultiTextureBatch();
+        s_immContext.multiBatch = false;
+    }
+
+    static void FlushMultiTextureBatch()
+    {
+        if(!s_immContext.multiBatchOpen) return;
+        s_immContext.multiBatchOpen = false;
+
+        if(!s_immContext.verts.empty())
+        {
+            for(s32 i=0; i<s_immContext.multiBatchTextureCount; ++i)
+                UseTexture(s_immContext.texture[i], i);
+
+            bool textureMapping = s_immContext.textureMapping;
+            s_immContext.textureMapping = true;
+            EndDraw();
+            s_immContext.textureMapping = textureMapping;
+        }
+
+        for(s32 i=0; i<s_immContext.multiBatchTextureCount; ++i)
+            s_immContext.texture[i] = NULL;
+        s_immContext.multiBatchTextureCount = 0;
     }
 
     static void DrawBatchedTexture(f32 x, f32 y, const Rect* clip, nkVec4 color)
     {
-        f32 s1 = 0;
-        f32 t1 = 0;
-        f32 s2 = s_immContext.batchTexture->w;
-        f32 t2 = s_immContext.batchTexture->h;
+        const Rect& region = s_immContext.batchRegion;
+
+        f32 s1 = region.x;
+        f32 t1 = region.y;
+        f32 s2 = s1+region.w;
+        f32 t2 = t1+region.h;
 
         if(clip)
         {
-            s1 = clip->x;
-            t1 = clip->y;
+            s1 = region.x+clip->x;
+            t1 = region.y+clip->y;
             s2 = s1+clip->w;
             t2 = t1+clip->h;
         }
@@ -1181,32 +2031,32 @@ namespace imm
 
     static void DrawBatchedTexture(f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
     {
-        f32 s1 = 0;
-        f32 t1 = 0;
-        f32 s2 = s_immContext.batchTexture->w;
-        f32 t2 = s_immContext.batchTexture->h;
+        Vertex quad[6];
+        GetBatchedTextureQuad(quad, x, y, sx, sy, angle, flip, anchor, clip, color);
+        PutVertices(quad, 6);
+    }
+
+    static void GetBatchedTextureQuad(Vertex* quad, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor, const Rect* clip, nkVec4 color)
+    {
+        const Rect& region = s_immContext.batchRegion;
+
+        f32 s1 = region.x;
+        f32 t1 = region.y;
+        f32 s2 = s1+region.w;
+        f32 t2 = t1+region.h;
 
         if(clip)
         {
-            s1 = clip->x;
-            t1 = clip->y;
+            s1 = region.x+clip->x;
+            t1 = region.y+clip->y;
             s2 = s1+clip->w;
             t2 = t1+clip->h;
         }
 
-        f32 ox = x;
-        f32 oy = y;
+        f32 w = (s2-s1);
+        f32 h = (t2-t1);
 
-        f32 ax = ((anchor) ? anchor->x : (s2-s1)*0.5f);
-        f32 ay = ((anchor) ? anchor->y : (t2-t1)*0.5f);
-
-        x -= ax;
-        y -= ay;
-
-        f32 x1 = 0.0f;
-        f32 y1 = 0.0f;
-        f32 x2 = (s2-s1);
-        f32 y2 = (t2-t1);
+        nkVec2 origin = ((anchor) ? *anchor : nkVec2 { w*0.5f, h*0.5f });
 
         // Normalize the texture coords.
         s1 /= s_immContext.batchTexture->w;
@@ -1217,44 +2067,38 @@ namespace imm
         if(NK_CHECK_FLAGS(flip, Flip_Horizontal)) sx = -sx;
         if(NK_CHECK_FLAGS(flip, Flip_Vertical)) sy = -sy;
 
-        nkMat4 modelMatrix = nk_m4_identity();
-        modelMatrix = nk_translate(modelMatrix, { ox,oy,0.0f });
-        modelMatrix = nk_scale(modelMatrix, { sx,sy,1.0f });
-        modelMatrix = nk_rotate(modelMatrix, { 0.0f,0.0f,1.0f }, angle);
-        modelMatrix = nk_translate(modelMatrix, { -ox,-oy,0.0f });
-        modelMatrix = nk_translate(modelMatrix, { x,y,0.0f });
+        // Scale and rotate the sprite around its anchor and then place the anchor at the position.
+        nkAffine2D transform = nk_a2_trs({ x,y }, { sx,sy }, angle, origin);
 
-        nkVec4 tl = {x1,y1,0.0f,1.0f};
-        nkVec4 tr = {x2,y1,0.0f,1.0f};
-        nkVec4 bl = {x1,y2,0.0f,1.0f};
-        nkVec4 br = {x2,y2,0.0f,1.0f};
+        nkVec2 corners[4] = { { 0,h }, { 0,0 }, { w,0 }, { w,h } }; // BL, TL, TR, BR
+        nk_a2_transform(transform, corners, corners, 4);
 
-        tl = modelMatrix * tl;
-        tr = modelMatrix * tr;
-        bl = modelMatrix * bl;
-        br = modelMatrix * br;
+        nkVec4 bl = { corners[0].x, corners[0].y, 0.0f, 1.0f };
+        nkVec4 tl = { corners[1].x, corners[1].y, 0.0f, 1.0f };
+        nkVec4 tr = { corners[2].x, corners[2].y, 0.0f, 1.0f };
+        nkVec4 br = { corners[3].x, corners[3].y, 0.0f, 1.0f };
 
-        PutVertex({ bl, color, {s1,t2} });
-        PutVertex({ tl, color, {s1,t1} });
-        PutVertex({ tr, color, {s2,t1} });
-        PutVertex({ tr, color, {s2,t1} });
-        PutVertex({ br, color, {s2,t2} });
-        PutVertex({ bl, color, {s1,t2} });
+        quad[0] = { bl, color, {s1,t2} };
+        quad[1] = { tl, color, {s1,t1} };
+        quad[2] = { tr, color, {s2,t1} };
+        quad[3] = { tr, color, {s2,t1} };
+        quad[4] = { br, color, {s2,t2} };
+        quad[5] = { bl, color, {s1,t2} };
     }
 
-    static void EnableAlphaBlending(bool enable)
+    static Rect GetBatchRegion()
     {
-        s_immContext.alphaBlending = enable;
+        return s_immContext.batchRegion;
     }
 
-    static void EnableTextureMapping(bool enable)
+    static nkVec2 GetBatchTextureSize()
     {
-        s_immContext.textureMapping = enable;
+        return { s_immContext.batchTexture->w, s_immContext.batchTexture->h };
     }
 
-    static bool IsAlphaBlendingEnabled()
+    static void EnableTextureMapping(bool enable)
     {
-        return s_immContext.alphaBlending;
+        s_immContext.textureMapping = enable;
     }
 
     static bool IsTextureMappingEnabled()
@@ -1262,6 +2106,11 @@ namespace imm
         return s_immContext.textureMapping;
     }
 
+    static nkVec4 PremultiplyColor(nkVec4 color)
+    {
+        return { color.r*color.a, color.g*color.a, color.b*color.a, color.a };
+    }
+
     static void SetCurrentShader(std::string shaderName)
     {
         if(shaderName.empty()) SetCurrentShader(NULL);
@@ -1275,6 +2124,7 @@ namespace imm
 
     static void SetCurrentShader(Shader shader)
     {
+        if(s_immContext.shader != shader) FlushMultiTextureBatch();
         s_immContext.shader = shader;
     }
 
@@ -1296,16 +2146,19 @@ namespace imm
 
     static nkMat4& GetProjectionMatrix()
     {
+        FlushMultiTextureBatch(); // The caller may be about to change it.
         return s_immContext.projectionMatrix;
     }
 
     static nkMat4& GetViewMatrix()
     {
+        FlushMultiTextureBatch(); // The caller may be about to change it.
         return s_immContext.viewMatrix;
     }
 
     static nkMat4& GetModelMatrix()
     {
+        FlushMultiTextureBatch(); // The caller may be about to change it.
         return s_immContext.modelMatrix;
     }
 }
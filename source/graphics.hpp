@@ -2,6 +2,11 @@ DECLARE_PRIVATE_STRUCT(VertexBuffer);
 DECLARE_PRIVATE_STRUCT(Shader);
 DECLARE_PRIVATE_STRUCT(Texture);
 DECLARE_PRIVATE_STRUCT(Framebuffer);
+DECLARE_PRIVATE_STRUCT(PaletteTexture);
+
+DECLARE_MEMORY_POOL(VertexBuffer);
+DECLARE_MEMORY_POOL(Shader);
+DECLARE_MEMORY_POOL(Texture);
 
 enum DrawMode
 {
@@ -59,7 +64,8 @@ static void InitGraphics();
 static void QuitGraphics();
 
 static void BeginRenderFrame();
-static void EndRenderFrame();
+static bool EndRenderFrame(); // Returns false if there was nothing to present, in which case the window shouldn't be swapped.
+static bool CanPresentLastFrame(); // False when rendering straight to the window, a redraw then needs the frame rendering again.
 
 static void Clear(f32 r, f32 g, f32 b, f32 a = 1.0f);
 static void Clear(nkVec4 color);
@@ -69,7 +75,7 @@ static void SetViewport(Rect* viewport = NULL); // NULL sets the viewport to the
 static void SetScreenScaleMode(ScaleMode scaleMode);
 static void SetScreenFilter(Filter filter);
 
-static Framebuffer GetScreen();
+static Framebuffer GetScreen(); // Contents are stale if the screen is being rendered directly to the window (1:1 scale).
 static u32 GetScreenTextureInternal();
 static Rect GetScreenBounds();
 static f32 GetScreenWidth();
@@ -84,7 +90,9 @@ static f32 GetRenderTargetWidth();
 static f32 GetRenderTargetHeight();
 
 static void UseShader(std::string shaderName);
-static void UseShader(Shader shader);
+static void UseShader(Shader shader, u32 keywords = 0); // Keywords are a combination of GetShaderKeyword bits.
+
+static u32 GetShaderKeyword(Shader shader, std::string keyword); // Bit that enables the keyword, 0 if the shader doesn't have it.
 
 static void UseTexture(std::string textureName, s32 unit = 0);
 static void UseTexture(Texture texture, s32 unit = 0);
@@ -92,7 +100,9 @@ static void UseTexture(Texture texture, s32 unit = 0);
 // These operate on the currently bound shader.
 static void SetShaderBool(std::string name, bool val);
 static void SetShaderInt(std::string name, s32 val);
+static void SetShaderIntArray(std::string name, const s32* vals, s32 count);
 static void SetShaderFloat(std::string name, f32 val);
+static void SetShaderFloatArray(std::string name, const f32* vals, s32 count);
 static void SetShaderVec2(std::string name, nkVec2 vec);
 static void SetShaderVec3(std::string name, nkVec3 vec);
 static void SetShaderVec4(std::string name, nkVec4 vec);
@@ -101,19 +111,40 @@ static void SetShaderMat3(std::string name, nkMat3 mat);
 static void SetShaderMat4(std::string name, nkMat4 mat);
 
 // Shader
+// A [Keywords] line in the source declares feature keywords, a variant of the program is built for every
+// combination of them with the enabled keywords #defined. UseShader picks the variant to draw with.
 static bool LoadShaderFromFile(Shader& shader, std::string fileName);
 static bool LoadShaderFromData(Shader& shader, void* data, size_t bytes);
+static bool ReloadShaderFromFile(Shader& shader, std::string fileName); // Keeps the old program if the new one fails to build.
 static void FreeShader(Shader& shader);
 
 // Texture
-static bool CreateTexture(Texture& texture, s32 w, s32 h, s32 bpp, void* data, Filter filter = Filter_Linear, Wrap wrap = Wrap_Clamp); // Expects RGBA order.
+static bool CreateTexture(Texture& texture, s32 w, s32 h, s32 bpp, void* data, Filter filter = Filter_Linear, Wrap wrap = Wrap_Clamp); // Expects RGBA order with premultiplied alpha.
+// Textures loaded from images are converted to premultiplied alpha.
 static bool LoadTextureFromFile(Texture& texture, std::string fileName, Filter filter = Filter_Linear, Wrap wrap = Wrap_Clamp);
 static bool LoadTextureFromData(Texture& texture, void* data, size_t bytes, Filter filter = Filter_Linear, Wrap wrap = Wrap_Clamp);
+static bool ReloadTextureFromFile(Texture& texture, std::string fileName);
 static void FreeTexture(Texture& texture);
 static f32 GetTextureWidth(Texture& texture);
 static f32 GetTextureHeight(Texture& texture);
 static void SetTextureFilter(Texture& texture, Filter filter);
 static void SetTextureWrap(Texture& texture, Wrap wrap);
+static Filter GetTextureFilter(const Texture& texture);
+static Wrap GetTextureWrap(const Texture& texture);
+static size_t GetTextureBytes(const Texture& texture); // Approximate VRAM used, zero for a NULL texture.
+
+// PaletteTexture
+// Cooked from sprite sheets that contain a recolored copy of their sprites per variant (see tools/packer.cpp).
+// Variants that are palette swaps of each other share a single channel index texture that gets resolved
+// against a palette in the fragment shader, variants that couldn't be indexed are kept in full color.
+static bool LoadPaletteTextureFromFile(PaletteTexture& texture, std::string fileName);
+static bool LoadPaletteTextureFromData(PaletteTexture& texture, void* data, size_t bytes);
+static bool ReloadPaletteTextureFromFile(PaletteTexture& texture, std::string fileName);
+static void FreePaletteTexture(PaletteTexture& texture);
+static f32 GetPaletteTextureVariantWidth(PaletteTexture& texture);
+static f32 GetPaletteTextureVariantHeight(PaletteTexture& texture);
+static s32 GetPaletteTextureVariantCount(PaletteTexture& texture);
+static size_t GetPaletteTextureBytes(const PaletteTexture& texture);
 
 // VertexBuffer
 static void CreateVertexBuffer(VertexBuffer& buffer);
@@ -137,6 +168,7 @@ public:
 
     bool        LoadFromFile(std::string fileName) override { return LoadShaderFromFile(m_data, fileName); }
     bool        LoadFromData(void* data, size_t bytes) override { return LoadShaderFromData(m_data, data, bytes); }
+    bool        ReloadFromFile(std::string fileName) override { return ReloadShaderFromFile(m_data, fileName); }
     void        Free() override { FreeShader(m_data); }
     #ifndef __EMSCRIPTEN__
     const char* GetPath() const override { return "shaders/gl_330/"; }
@@ -151,15 +183,39 @@ DECLARE_ASSET(Texture)
 {
 public:
     Texture m_data;
+    Filter  m_filter = Filter_Linear; // Kept outside the texture so they survive it being evicted and reloaded.
+    Wrap    m_wrap = Wrap_Clamp;
 
-    bool        LoadFromFile(std::string fileName) override { return LoadTextureFromFile(m_data, fileName); }
-    bool        LoadFromData(void* data, size_t bytes) override { return LoadTextureFromData(m_data, data, bytes); }
-    void        Free() override { FreeTexture(m_data); }
+    bool        LoadFromFile(std::string fileName) override { return LoadTextureFromFile(m_data, fileName, m_filter, m_wrap); }
+    bool        LoadFromData(void* data, size_t bytes) override { return LoadTextureFromData(m_data, data, bytes, m_filter, m_wrap); }
+    bool        ReloadFromFile(std::string fileName) override { return ReloadTextureFromFile(m_data, fileName); }
+    void        Free() override
+    {
+        if(m_data) { m_filter = GetTextureFilter(m_data); m_wrap = GetTextureWrap(m_data); }
+        FreeTexture(m_data);
+        m_data = NULL;
+    }
+    size_t      GetResidentBytes() const override { return GetTextureBytes(m_data); }
     const char* GetPath() const override { return "textures/"; }
     const char* GetExt() const override { return ".png"; }
     const char* GetType() const override { return "Texture"; }
 };
 
+DECLARE_ASSET(PaletteTexture)
+{
+public:
+    PaletteTexture m_data;
+
+    bool        LoadFromFile(std::string fileName) override { return LoadPaletteTextureFromFile(m_data, fileName); }
+    bool        LoadFromData(void* data, size_t bytes) override { return LoadPaletteTextureFromData(m_data, data, bytes); }
+    bool        ReloadFromFile(std::string fileName) override { return ReloadPaletteTextureFromFile(m_data, fileName); }
+    void        Free() override { FreePaletteTexture(m_data); }
+    size_t      GetResidentBytes() const override { return GetPaletteTextureBytes(m_data); }
+    const char* GetPath() const override { return "textures/"; }
+    const char* GetExt() const override { return ".ptex"; }
+    const char* GetType() const override { return "PaletteTexture"; }
+};
+
 namespace imm
 {
     struct Vertex
@@ -167,8 +223,12 @@ namespace imm
         nkVec4 position;
         nkVec4 color;
         nkVec2 texCoord;
+        nkVec3 texUnits = { 0,-1,0 }; // Unit to sample, unit of the palette to resolve against (-1 for none) and palette row. Filled in by PutVertex.
     };
 
+    // Maximum number of textures that can be bound for a single multi-texture batch, must match the imm shader.
+    static constexpr s32 k_maxBatchTextures = 8;
+
     enum Flip
     {
         Flip_None       = 0,
@@ -188,26 +248,51 @@ namespace imm
     static void DrawCircleFilled(f32 x, f32 y, f32 r, nkVec4 color, s32 segments = 64);
     static void DrawTexture(std::string textureName, f32 x, f32 y, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
     static void DrawTexture(std::string textureName, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    static void DrawTexture(AssetHandle<Texture>& textureHandle, f32 x, f32 y, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    static void DrawTexture(AssetHandle<Texture>& textureHandle, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
     static void DrawTexture(Texture& texture, f32 x, f32 y, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
     static void DrawTexture(Texture& texture, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    // Clips are relative to the chosen variant rather than the whole texture.
+    static void DrawPaletteTexture(AssetHandle<PaletteTexture>& textureHandle, s32 variant, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    static void DrawPaletteTexture(PaletteTexture& texture, s32 variant, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
     static void DrawFramebuffer(Framebuffer& framebuffer, f32 dstX0, f32 dstY0, f32 dstX1, f32 dstY1);
 
     static void BeginDraw(DrawMode drawMode);
     static void EndDraw();
     static void PutVertex(Vertex v);
+    static void PutVertices(const Vertex* verts, size_t count);
 
     static void BeginTextureBatch(std::string textureName);
+    static void BeginTextureBatch(AssetHandle<Texture>& textureHandle);
     static void BeginTextureBatch(Texture& texture);
+    static void BeginPaletteTextureBatch(AssetHandle<PaletteTexture>& textureHandle, s32 variant); // Clips are relative to the variant.
+    static void BeginPaletteTextureBatch(PaletteTexture& texture, s32 variant);
     static void EndTextureBatch();
     static void DrawBatchedTexture(f32 x, f32 y, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
     static void DrawBatchedTexture(f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    // Builds the six vertices DrawBatchedTexture would put so they can be kept around and put again later.
+    static void GetBatchedTextureQuad(Vertex* quad, f32 x, f32 y, f32 sx, f32 sy, f32 angle, Flip flip, const nkVec2* anchor = NULL, const Rect* clip = NULL, nkVec4 color = { 1,1,1,1 });
+    // What a kept quad's texture coords depend on, if either changes (e.g. the texture reloads) the quad needs rebuilding.
+    static Rect GetBatchRegion();
+    static nkVec2 GetBatchTextureSize();
+
+    // Between these calls texture batches and texture draws don't end the draw when the texture changes, instead
+    // up to k_maxBatchTextures are bound at once and each vertex carries the unit it samples from. The draw is
+    // only flushed when the units run out or something that can't be batched is drawn (e.g. a filled rect).
+    // If the GPU doesn't have enough texture units this falls back to a draw per texture batch like normal.
+    static void BeginMultiTextureBatch();
+    static void EndMultiTextureBatch();
+    static void FlushMultiTextureBatch(); // Needs calling before any direct GL calls made inside of a multi-texture batch.
 
-    static void EnableAlphaBlending(bool enable);
     static void EnableTextureMapping(bool enable);
 
-    static bool IsAlphaBlendingEnabled();
     static bool IsTextureMappingEnabled();
 
+    // Everything is drawn with premultiplied alpha using a single blend mode, so colors given to imm must
+    // be premultiplied too. The alpha of a color controls how much it covers what is behind it, meaning an
+    // alpha of zero blends additively, so additive draws don't need a separate blend mode or batch.
+    static nkVec4 PremultiplyColor(nkVec4 color); // From a straight alpha color.
+
     static void SetCurrentShader(std::string shaderName);
     static void SetCurrentShader(Shader shader);
     static void SetCurrentTexture(std::string textureName, s32 unit = 0);
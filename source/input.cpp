@@ -306,3 +306,10 @@ static bool IsLeftStickLeftPressed()
     return (GetInput().previousAxisState[GamepadAxis_LeftX] >= -k_gamepadStickDeadzone &&
             GetInput().currentAxisState[GamepadAxis_LeftX] < -k_gamepadStickDeadzone);
 }
+
+// General
+
+static f32 GetInputIdleTime()
+{
+    return NK_CAST(f32, SDL_GetTicks() - GetInput().lastInputTime) / 1000.0f;
+}
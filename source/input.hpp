@@ -105,3 +105,8 @@ static bool IsLeftStickUpPressed();
 static bool IsLeftStickRightPressed();
 static bool IsLeftStickDownPressed();
 static bool IsLeftStickLeftPressed();
+
+// General
+
+// Seconds since the player last touched any of the inputs, useful for dropping into an idle state.
+static f32 GetInputIdleTime();
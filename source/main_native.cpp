@@ -9,6 +9,20 @@ int main(int argc, char** argv)
     // Cache useful paths.
     s_context.execPath = ValidatePath(SDL_GetBasePath());
 
+    // Rendering a recorded audio session doesn't need a window or a sound card, so it can run on headless machines.
+    if(!s_appConfig.audioRenderSession.empty())
+    {
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+        if(SDL_Init(SDL_INIT_AUDIO) < 0)
+            FatalError("Failed to initialize SDL2!\n");
+        NK_DEFER(SDL_Quit());
+        InitAssetManager();
+        NK_DEFER(QuitAssetManager());
+        InitAudio(true);
+        NK_DEFER(QuitAudio());
+        return (RenderAudioSession(s_appConfig.audioRenderSession, s_appConfig.audioRenderOutput)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     printf("Starting Application %s...\n", s_appConfig.title.c_str());
 
     if(SDL_Init(SDL_INIT_EVERYTHING) < 0)
@@ -92,6 +106,10 @@ int main(int argc, char** argv)
     InitAudio();
     NK_DEFER(QuitAudio());
 
+    if(!s_appConfig.audioRecordFile.empty())
+        StartAudioRecording(s_appConfig.audioRecordFile);
+    NK_DEFER(StopAudioRecording());
+
     SetSoundVolume(soundVolume);
     SetMusicVolume(musicVolume);
 
@@ -103,8 +121,8 @@ int main(int argc, char** argv)
     u64 endCounter = 0;
     u64 elapsedCounter = 0;
     f32 updateTimer = 0.0f;
-
-    f32 deltaTime = 1.0f / s_appConfig.tickrate; // We use a fixed update rate to keep things deterministic.
+    u32 waitTime = 0;
+    bool redraw = false;
 
     // Enable VSync by default, if we don't get it then oh well.
     if(SDL_GL_SetSwapInterval(1) == 0)
@@ -114,6 +132,13 @@ int main(int argc, char** argv)
 
     while(s_appConfig.app->m_running)
     {
+        BeginMemoryFrame();
+
+        // Rather than spinning until the next tick is due we block on events, this is what saves power when
+        // the app is idle or asleep. Passing no event means anything that wakes us is left for the poll below.
+        if(waitTime > 0)
+            SDL_WaitEventTimeout(NULL, waitTime);
+
         SDL_Event event;
         while(SDL_PollEvent(&event))
         {
@@ -129,6 +154,14 @@ int main(int argc, char** argv)
                             FullscreenWindow(!IsFullscreen());
                             ResetCursor();
                         } break;
+                        #ifdef BUILD_DEBUG
+                        case SDLK_F3:
+                        {
+                            PrintMemoryStats();
+                            PrintAssetMemoryStats();
+                            PrintAudioStats();
+                        } break;
+                        #endif // BUILD_DEBUG
                     }
                 } break;
                 case SDL_QUIT:
@@ -143,6 +176,8 @@ int main(int argc, char** argv)
                         {
                             case SDL_WINDOWEVENT_MAXIMIZED: s_context.maximized = true; break;
                             case SDL_WINDOWEVENT_RESTORED: s_context.maximized = false; break;
+                            case SDL_WINDOWEVENT_EXPOSED: redraw = true; break;
+                            case SDL_WINDOWEVENT_SIZE_CHANGED: redraw = true; break;
                         }
                     }
                 } break;
@@ -157,24 +192,42 @@ int main(int argc, char** argv)
             }
         }
 
+        UpdateAssetManager();
+
+        // We use a fixed update rate to keep things deterministic, dropping to a lower one when the app is idle.
+        PowerMode powerMode = s_appConfig.app->m_powerMode;
+        f32 deltaTime = 1.0f / ((powerMode == PowerMode_Active) ? s_appConfig.tickrate : s_appConfig.idleTickrate);
+
         bool didUpdate = false;
         while(updateTimer >= deltaTime)
         {
             UpdateInputState();
+            UpdateAudio();
             s_appConfig.app->OnUpdate(deltaTime);
             updateTimer -= deltaTime;
             didUpdate = true;
         }
-        if(didUpdate)
+        // When rendering directly to the window an exposed window can't just be presented again, so re-render
+        // the current state without advancing anything.
+        bool rerender = (redraw && !didUpdate && !CanPresentLastFrame());
+        if(didUpdate || rerender)
         {
             SetViewport(NULL);
             Clear(s_appConfig.clearColor);
             BeginRenderFrame();
-            s_appConfig.app->OnRender(deltaTime);
+            s_appConfig.app->OnRender((rerender) ? 0.0f : deltaTime);
+        }
+        // If nothing has changed since the last present there's no point doing it again.
+        bool presented = false;
+        if(didUpdate || redraw)
+        {
+            if(EndRenderFrame())
+            {
+                SDL_GL_SwapWindow(s_context.window);
+                presented = true;
+            }
+            redraw = false;
         }
-        EndRenderFrame();
-
-        SDL_GL_SwapWindow(s_context.window);
 
         endCounter = SDL_GetPerformanceCounter();
         elapsedCounter = endCounter - lastCounter;
@@ -184,10 +237,29 @@ int main(int argc, char** argv)
 
         updateTimer += elapsedTime;
 
+        // Work out how long we can wait for before the next loop. When asleep we tick once each time we are
+        // woken as there is nothing to catch up on, otherwise if nothing was presented VSync won't throttle us.
+        waitTime = 0;
+        if(s_appConfig.app->m_powerMode == PowerMode_Sleep)
+        {
+            updateTimer = deltaTime;
+            waitTime = k_sleepWaitTime;
+        }
+        else if(!presented && updateTimer < deltaTime)
+        {
+            waitTime = NK_CAST(u32, ceilf((deltaTime - updateTimer) * 1000.0f));
+        }
+
         #ifdef BUILD_DEBUG
-        f32 currentFPS = NK_CAST(f32,perfFrequency) / NK_CAST(f32,elapsedCounter);
-        std::string title = s_appConfig.title + " (FPS: " + std::to_string(currentFPS) + ")";
-        SDL_SetWindowTitle(s_context.window, title.c_str());
+        // The title is formatted into the frame arena, so only update it for frames that reset the arena.
+        if(didUpdate)
+        {
+            f32 currentFPS = NK_CAST(f32,perfFrequency) / NK_CAST(f32,elapsedCounter);
+            const MemoryStats& memoryStats = GetFrameMemoryStats();
+            const FrameArenaStats& arenaStats = GetFrameArenaStats();
+            std::string_view title = FrameFormat("%s (FPS: %f, Allocs: %zu, Arena: %zu)", s_appConfig.title.c_str(), currentFPS, memoryStats.allocations, arenaStats.used);
+            SDL_SetWindowTitle(s_context.window, title.data());
+        }
         #endif // BUILD_DEBUG
 
         // The window starts out hidden, after the first draw we unhide the window as this looks quite clean.
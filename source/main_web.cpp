@@ -5,8 +5,9 @@ void main_loop()
     static u64 endCounter = 0;
     static u64 elapsedCounter = 0;
     static f32 updateTimer = 0.0f;
+    static PowerMode currentPowerMode = PowerMode_Active;
 
-    static f32 deltaTime = 1.0f / s_appConfig.tickrate; // We use a fixed update rate to keep things deterministic.
+    BeginMemoryFrame();
 
     SDL_Event event;
     while(SDL_PollEvent(&event))
@@ -24,10 +25,29 @@ void main_loop()
         }
     }
 
+    UpdateAssetManager();
+
+    // We use a fixed update rate to keep things deterministic, dropping to a lower one when the app is idle.
+    PowerMode powerMode = s_appConfig.app->m_powerMode;
+    f32 deltaTime = 1.0f / ((powerMode == PowerMode_Active) ? s_appConfig.tickrate : s_appConfig.idleTickrate);
+
+    // We can't block on events in the browser, instead we have it call us less often when idle or asleep.
+    if(currentPowerMode != powerMode)
+    {
+        switch(powerMode)
+        {
+            case PowerMode_Active: emscripten_set_main_loop_timing(EM_TIMING_RAF, 1); break;
+            case PowerMode_Idle: emscripten_set_main_loop_timing(EM_TIMING_SETTIMEOUT, NK_CAST(s32, deltaTime * 1000.0f)); break;
+            case PowerMode_Sleep: emscripten_set_main_loop_timing(EM_TIMING_SETTIMEOUT, k_sleepWaitTime); break;
+        }
+        currentPowerMode = powerMode;
+    }
+
     bool didUpdate = false;
     while(updateTimer >= deltaTime)
     {
         UpdateInputState();
+        UpdateAudio();
         s_appConfig.app->OnUpdate(deltaTime);
         updateTimer -= deltaTime;
         didUpdate = true;
@@ -39,9 +59,12 @@ void main_loop()
         BeginRenderFrame();
         s_appConfig.app->OnRender(deltaTime);
     }
-    EndRenderFrame();
-
-    SDL_GL_SwapWindow(s_context.window);
+    // If nothing has changed since the last present there's no point doing it again.
+    if(didUpdate)
+    {
+        if(EndRenderFrame())
+            SDL_GL_SwapWindow(s_context.window);
+    }
 
     endCounter = SDL_GetPerformanceCounter();
     elapsedCounter = endCounter - lastCounter;
@@ -51,10 +74,20 @@ void main_loop()
 
     updateTimer += elapsedTime;
 
+    // When asleep we tick once each time we are called as there is nothing to catch up on.
+    if(s_appConfig.app->m_powerMode == PowerMode_Sleep)
+        updateTimer = deltaTime;
+
     #ifdef BUILD_DEBUG
-    f32 currentFPS = NK_CAST(f32,perfFrequency) / NK_CAST(f32,elapsedCounter);
-    std::string title = s_appConfig.title + " (FPS: " + std::to_string(currentFPS) + ")";
-    SDL_SetWindowTitle(s_context.window, title.c_str());
+    // The title is formatted into the frame arena, so only update it for frames that reset the arena.
+    if(didUpdate)
+    {
+        f32 currentFPS = NK_CAST(f32,perfFrequency) / NK_CAST(f32,elapsedCounter);
+        const MemoryStats& memoryStats = GetFrameMemoryStats();
+        const FrameArenaStats& arenaStats = GetFrameArenaStats();
+        std::string_view title = FrameFormat("%s (FPS: %f, Allocs: %zu, Arena: %zu)", s_appConfig.title.c_str(), currentFPS, memoryStats.allocations, arenaStats.used);
+        SDL_SetWindowTitle(s_context.window, title.data());
+    }
     #endif // BUILD_DEBUG
 }
 
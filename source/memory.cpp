@@ -4,45 +4,420 @@ struct MemoryMetaData
     const char* typeName;
     size_t typeSize;
     size_t count;
+    const void* data; // NULL when the entry is free.
 };
 
-static std::map<const void*,MemoryMetaData> s_trackedMemory;
+template<typename T>
+struct MemoryPool
+{
+    static constexpr u32 k_blockSize = 64;
+    static constexpr u32 k_invalidSlot = UINT32_MAX;
+
+    struct Slot
+    {
+        alignas(T) u8 data[sizeof(T)]; // Must be first so we can get from an object back to its slot.
+        u32 index;
+        bool used;
+        u32 nextFree; // Next slot in the free list when unused.
+        u32 tracking; // Index into the tracked memory table when used.
+    };
+
+    std::vector<Slot*> blocks;
+    u32 freeHead = k_invalidSlot;
+    u32 slotCount = 0;
+
+    ~MemoryPool() { for(Slot* block: blocks) free(block); }
+
+    Slot* GetSlot(u32 index) { return &blocks[index / k_blockSize][index % k_blockSize]; }
+};
+
+template<typename T>
+static MemoryPool<T> s_memoryPool;
+
+// Header placed before objects that are not pooled so we know where they are in the tracked memory table.
+static constexpr size_t k_trackHeaderSize = alignof(std::max_align_t);
+
+// Counters are atomic as the hooks can be hit from any thread that allocates.
+struct MemoryCounters
+{
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytes;
+    std::atomic<size_t> liveBytes;
+    std::atomic<size_t> peakBytes;
+    std::atomic<size_t> hotAllocations;
+};
+
+static constexpr size_t k_maxMemoryCategories = 16;
+
+struct FrameArena
+{
+    alignas(std::max_align_t) u8 data[k_frameArenaSize];
+    size_t used;
+    size_t overflows;
+    std::vector<void*> overflowed; // Heap allocations to free on reset.
+    FrameArenaStats stats;
+};
+
+static std::vector<MemoryMetaData> s_trackedMemory;
+static std::vector<u32> s_trackedMemoryFree;
+static FrameArena s_frameArena;
+
+static MemoryCounters s_memoryCounters;
+static MemoryStats s_lastFrameMemoryStats;
+static MemoryCategoryStats s_memoryCategories[k_maxMemoryCategories];
+static size_t s_memoryCategoryAllocations[k_maxMemoryCategories]; // Allocations made during the current frame.
+static size_t s_memoryCategoryCount;
+static bool s_zeroAllocMode;
+static thread_local s32 s_noAllocScopeDepth;
 
-static void TrackMemory(const MemoryTag& tag, const char* typeName, size_t typeSize, size_t count, const void* data)
+#ifdef BUILD_DEBUG
+// We store the size of each allocation in a header so it can be untracked on delete, along with the block
+// that was actually malloc'd as over-aligned allocations have to be offset into it. The header is the size
+// of the maximum fundamental alignment so that the returned memory stays suitably aligned.
+static constexpr size_t k_allocHeaderSize = alignof(std::max_align_t);
+
+struct AllocHeader
 {
-    s_trackedMemory.insert({ data, { tag, typeName, typeSize, count } });
+    void*  block;
+    size_t size;
+};
+
+static_assert(sizeof(AllocHeader) <= k_allocHeaderSize, "AllocHeader doesn't fit in the allocation header!");
+
+static void* TrackedAlloc(size_t size, size_t alignment)
+{
+    // Allocations up to the fundamental alignment just sit after the header, anything bigger needs padding.
+    size_t padding = (alignment > k_allocHeaderSize) ? alignment : 0;
+    u8* block = NK_CAST(u8*, malloc(size + k_allocHeaderSize + padding));
+    if(!block) return NULL;
+
+    u8* data = block + k_allocHeaderSize;
+    if(padding)
+        data = NK_CAST(u8*, (NK_CAST(uintptr_t, data) + (alignment-1)) & ~NK_CAST(uintptr_t, alignment-1));
+    AllocHeader* header = NK_CAST(AllocHeader*, data - sizeof(AllocHeader));
+    header->block = block;
+    header->size = size;
+
+    s_memoryCounters.allocations++;
+    s_memoryCounters.bytes += size;
+    size_t liveBytes = (s_memoryCounters.liveBytes += size);
+    size_t peakBytes = s_memoryCounters.peakBytes;
+    while(liveBytes > peakBytes && !s_memoryCounters.peakBytes.compare_exchange_weak(peakBytes, liveBytes));
+
+    if(s_noAllocScopeDepth > 0)
+    {
+        s_memoryCounters.hotAllocations++;
+        if(s_zeroAllocMode)
+        {
+            fprintf(stderr, "Heap allocation of %zu bytes inside of a no-alloc scope!\n", size);
+            ASSERT(false, "Heap allocation inside of a no-alloc scope!");
+        }
+    }
+
+    return data;
 }
 
-static void UntrackMemory(const void* data)
+static void TrackedFree(void* data)
 {
-    s_trackedMemory.erase(data);
+    if(!data) return;
+    AllocHeader* header = NK_CAST(AllocHeader*, NK_CAST(u8*, data) - sizeof(AllocHeader));
+    s_memoryCounters.liveBytes -= header->size;
+    free(header->block);
+}
+
+// Every replaceable form of new/delete is hooked so that nothing slips past the stats and no-alloc scopes,
+// the sized deletes also have to be replaced otherwise they go to the library default with our pointers.
+void* operator new(size_t size)
+{
+    void* data = TrackedAlloc(size, k_allocHeaderSize);
+    if(!data) throw std::bad_alloc();
+    return data;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* data = TrackedAlloc(size, NK_CAST(size_t, alignment));
+    if(!data) throw std::bad_alloc();
+    return data;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAlloc(size, k_allocHeaderSize);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAlloc(size, k_allocHeaderSize);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return TrackedAlloc(size, NK_CAST(size_t, alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return TrackedAlloc(size, NK_CAST(size_t, alignment));
+}
+
+void operator delete(void* data) noexcept { TrackedFree(data); }
+void operator delete[](void* data) noexcept { TrackedFree(data); }
+void operator delete(void* data, size_t) noexcept { TrackedFree(data); }
+void operator delete[](void* data, size_t) noexcept { TrackedFree(data); }
+void operator delete(void* data, std::align_val_t) noexcept { TrackedFree(data); }
+void operator delete[](void* data, std::align_val_t) noexcept { TrackedFree(data); }
+void operator delete(void* data, size_t, std::align_val_t) noexcept { TrackedFree(data); }
+void operator delete[](void* data, size_t, std::align_val_t) noexcept { TrackedFree(data); }
+void operator delete(void* data, const std::nothrow_t&) noexcept { TrackedFree(data); }
+void operator delete[](void* data, const std::nothrow_t&) noexcept { TrackedFree(data); }
+void operator delete(void* data, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(data); }
+void operator delete[](void* data, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(data); }
+#endif // BUILD_DEBUG
+
+static MemoryCategoryStats* GetMemoryCategory(const char* category)
+{
+    for(size_t i=0; i<s_memoryCategoryCount; ++i)
+        if(strcmp(s_memoryCategories[i].category, category) == 0)
+            return &s_memoryCategories[i];
+    if(s_memoryCategoryCount >= k_maxMemoryCategories)
+        return NULL;
+    MemoryCategoryStats* stats = &s_memoryCategories[s_memoryCategoryCount++];
+    stats->category = category;
+    return stats;
+}
+
+static u32 TrackMemory(const MemoryTag& tag, const char* typeName, size_t typeSize, size_t count, const void* data)
+{
+    u32 index;
+    if(!s_trackedMemoryFree.empty())
+    {
+        index = s_trackedMemoryFree.back();
+        s_trackedMemoryFree.pop_back();
+        s_trackedMemory[index] = { tag, typeName, typeSize, count, data };
+    }
+    else
+    {
+        index = NK_CAST(u32, s_trackedMemory.size());
+        s_trackedMemory.push_back({ tag, typeName, typeSize, count, data });
+    }
+
+    MemoryCategoryStats* stats = GetMemoryCategory(tag.category);
+    if(stats)
+    {
+        stats->objects++;
+        stats->bytes += typeSize * count;
+        s_memoryCategoryAllocations[stats - s_memoryCategories]++;
+    }
+
+    return index;
+}
+
+static void UntrackMemory(u32 index)
+{
+    MemoryMetaData& metaData = s_trackedMemory[index];
+    ASSERT(metaData.data, "Untracking memory that isn't tracked!");
+
+    MemoryCategoryStats* stats = GetMemoryCategory(metaData.tag.category);
+    if(stats)
+    {
+        stats->objects--;
+        stats->bytes -= metaData.typeSize * metaData.count;
+    }
+
+    metaData.data = NULL;
+    s_trackedMemoryFree.push_back(index);
 }
 
 static void CheckTrackedMemory()
 {
-    if(!s_trackedMemory.empty())
+    if(s_trackedMemoryFree.size() != s_trackedMemory.size())
     {
         printf("Memory Leaks Present:\n");
-        for(auto [data,metaData]: s_trackedMemory)
+        for(auto& metaData: s_trackedMemory)
         {
+            if(!metaData.data) continue;
+            const void* data = metaData.data;
             std::string fileName = StripFileExtensionAndPath(metaData.tag.fileName);
-            printf("[%s,%d] %s Memory: %zd %s (0x%p) %zd bytes\n", fileName.c_str(), metaData.tag.lineNumber,
+            printf("[%s,%d] %s Memory: %zu %s (0x%p) %zu bytes\n", fileName.c_str(), metaData.tag.lineNumber,
                 metaData.tag.category, metaData.count, metaData.typeName, data, metaData.count * metaData.typeSize);
         }
     }
 }
 
+static void BeginMemoryFrame()
+{
+    s_lastFrameMemoryStats.allocations = s_memoryCounters.allocations.exchange(0);
+    s_lastFrameMemoryStats.bytes = s_memoryCounters.bytes.exchange(0);
+    s_lastFrameMemoryStats.liveBytes = s_memoryCounters.liveBytes;
+    s_lastFrameMemoryStats.peakBytes = s_memoryCounters.peakBytes.exchange(s_memoryCounters.liveBytes);
+    s_lastFrameMemoryStats.hotAllocations = s_memoryCounters.hotAllocations.exchange(0);
+
+    for(size_t i=0; i<s_memoryCategoryCount; ++i)
+    {
+        s_memoryCategories[i].allocations = s_memoryCategoryAllocations[i];
+        s_memoryCategoryAllocations[i] = 0;
+    }
+}
+
+static const MemoryStats& GetFrameMemoryStats()
+{
+    return s_lastFrameMemoryStats;
+}
+
+static void PrintMemoryStats()
+{
+    const MemoryStats& stats = s_lastFrameMemoryStats;
+    printf("Memory: %zu allocations (%zu bytes) last frame, %zu in no-alloc scopes, %zu bytes live, %zu bytes peak\n",
+        stats.allocations, stats.bytes, stats.hotAllocations, stats.liveBytes, stats.peakBytes);
+    const FrameArenaStats& arena = s_frameArena.stats;
+    printf("  Frame Arena: %zu bytes used last frame, %zu bytes high-water mark (of %zu), %zu overflows\n",
+        arena.used, arena.highWater, k_frameArenaSize, arena.overflows);
+    for(size_t i=0; i<s_memoryCategoryCount; ++i)
+    {
+        const MemoryCategoryStats& category = s_memoryCategories[i];
+        printf("  %s Memory: %zu objects (%zu bytes), %zu allocations last frame\n",
+            category.category, category.objects, category.bytes, category.allocations);
+    }
+}
+
+static void SetZeroAllocMode(bool enable)
+{
+    s_zeroAllocMode = enable;
+}
+
+static void BeginNoAllocScope()
+{
+    s_noAllocScopeDepth++;
+}
+
+static void EndNoAllocScope()
+{
+    ASSERT(s_noAllocScopeDepth > 0, "Unbalanced no-alloc scope!");
+    s_noAllocScopeDepth--;
+}
+
+static void* FrameAlloc(size_t bytes, size_t alignment)
+{
+    size_t offset = (s_frameArena.used + (alignment-1)) & ~(alignment-1);
+    if(offset + bytes > k_frameArenaSize)
+    {
+        #ifdef BUILD_DEBUG
+        if(!s_frameArena.overflows)
+            printf("Frame arena overflowed, falling back to the heap! (%zu bytes requested)\n", bytes);
+        #endif // BUILD_DEBUG
+        s_frameArena.overflows++;
+        void* data = operator new(bytes);
+        s_frameArena.overflowed.push_back(data);
+        return data;
+    }
+    s_frameArena.used = offset + bytes;
+    return &s_frameArena.data[offset];
+}
+
+static void ResetFrameArena()
+{
+    s_frameArena.stats.used = s_frameArena.used;
+    s_frameArena.stats.highWater = std::max(s_frameArena.stats.highWater, s_frameArena.used);
+    s_frameArena.stats.overflows = s_frameArena.overflows;
+    s_frameArena.used = 0;
+    s_frameArena.overflows = 0;
+    for(void* data: s_frameArena.overflowed)
+        operator delete(data);
+    s_frameArena.overflowed.clear();
+}
+
+static const FrameArenaStats& GetFrameArenaStats()
+{
+    return s_frameArena.stats;
+}
+
+static std::string_view FrameFormat(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    s32 length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if(length < 0) return std::string_view();
+
+    char* buffer = NK_CAST(char*, FrameAlloc(length+1, alignof(char)));
+    va_start(args, format);
+    vsnprintf(buffer, length+1, format, args);
+    va_end(args);
+
+    return std::string_view(buffer, length);
+}
+
 template<typename T>
 static T* Allocate(const MemoryTag& tag)
 {
-    T* data = new T; // Need to use new because some of our stuff uses STL and needs constructors...
-    TrackMemory(tag, typeid(T).name(), sizeof(T), 1, NK_CAST(void*, data));
-    return data;
+    // Need to use placement new because some of our stuff uses STL and needs constructors...
+    if constexpr(MemoryPoolTraits<T>::k_pooled)
+    {
+        MemoryPool<T>& pool = s_memoryPool<T>;
+        if(pool.freeHead == MemoryPool<T>::k_invalidSlot)
+        {
+            auto* block = NK_CAST(typename MemoryPool<T>::Slot*, malloc(sizeof(typename MemoryPool<T>::Slot) * MemoryPool<T>::k_blockSize));
+            if(!block) FatalError("Failed to allocate memory pool block for %s!", typeid(T).name());
+            pool.blocks.push_back(block);
+            // Push the new slots onto the free list in reverse so they get handed out in order.
+            for(u32 i=MemoryPool<T>::k_blockSize; i>0; --i)
+            {
+                block[i-1].index = pool.slotCount + (i-1);
+                block[i-1].used = false;
+                block[i-1].nextFree = pool.freeHead;
+                pool.freeHead = block[i-1].index;
+            }
+            pool.slotCount += MemoryPool<T>::k_blockSize;
+        }
+
+        auto* slot = pool.GetSlot(pool.freeHead);
+        pool.freeHead = slot->nextFree;
+        slot->used = true;
+        T* data = new (slot->data) T;
+        slot->tracking = TrackMemory(tag, typeid(T).name(), sizeof(T), 1, data);
+        return data;
+    }
+    else
+    {
+        static_assert(alignof(T) <= k_trackHeaderSize, "Type is over-aligned for the tracking header!");
+        u8* block = NK_CAST(u8*, operator new(k_trackHeaderSize + sizeof(T)));
+        T* data = new (block + k_trackHeaderSize) T;
+        *NK_CAST(u32*, block) = TrackMemory(tag, typeid(T).name(), sizeof(T), 1, data);
+        return data;
+    }
 }
 
 template<typename T>
 static void Deallocate(T* data)
 {
-    UntrackMemory(NK_CAST(void*, data));
-    delete data;
+    if(!data) return;
+    if constexpr(MemoryPoolTraits<T>::k_pooled)
+    {
+        MemoryPool<T>& pool = s_memoryPool<T>;
+        auto* slot = NK_CAST(typename MemoryPool<T>::Slot*, NK_CAST(void*, data));
+        ASSERT(slot->used, "Deallocating a pool slot that isn't in use!");
+        data->~T();
+        UntrackMemory(slot->tracking);
+        slot->used = false;
+        slot->nextFree = pool.freeHead;
+        pool.freeHead = slot->index;
+    }
+    else
+    {
+        u8* block = NK_CAST(u8*, data) - k_trackHeaderSize;
+        data->~T();
+        UntrackMemory(*NK_CAST(u32*, block));
+        operator delete(block);
+    }
 }
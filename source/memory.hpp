@@ -10,11 +10,77 @@ struct MemoryTag
     nkVec4      color;
 };
 
-static void TrackMemory(const MemoryTag& tag, const char* typeName, size_t typeSize, size_t count, const void* data);
-static void UntrackMemory(const void* data);
+// Heap statistics gathered by the global operator new/delete hooks, these are only collected in debug builds.
+struct MemoryStats
+{
+    size_t allocations;    // Allocations made during the frame.
+    size_t bytes;          // Bytes allocated during the frame.
+    size_t liveBytes;      // Bytes currently allocated.
+    size_t peakBytes;      // Highest number of live bytes reached during the frame.
+    size_t hotAllocations; // Allocations made inside of a no-alloc scope.
+};
+
+// Statistics for objects created with Allocate<T>, grouped by their MemoryTag category.
+struct MemoryCategoryStats
+{
+    const char* category;
+    size_t      objects;     // Objects currently allocated.
+    size_t      bytes;       // Bytes currently allocated.
+    size_t      allocations; // Allocations made during the last frame.
+};
+
+// Tracked allocations live in a flat table, the returned index is stored alongside the allocation so untracking is O(1).
+static u32 TrackMemory(const MemoryTag& tag, const char* typeName, size_t typeSize, size_t count, const void* data);
+static void UntrackMemory(u32 index);
 
 static void CheckTrackedMemory();
 
+// Should be called once at the start of every frame, moves the current stats into the previous frame.
+static void BeginMemoryFrame();
+static const MemoryStats& GetFrameMemoryStats(); // Stats for the last completed frame.
+static void PrintMemoryStats();
+
+// When zero alloc mode is enabled any heap allocation made on the current thread inside of a no-alloc
+// scope will assert. Scopes can be nested. Allocations inside scopes are always counted in the stats.
+static void SetZeroAllocMode(bool enable);
+static void BeginNoAllocScope();
+static void EndNoAllocScope();
+
+// Linear allocator for transient data that only needs to live for a single frame. The arena is reset in
+// BeginRenderFrame so nothing allocated from it should be held on to past that point. If the arena ever
+// runs out of space allocations fallback to the heap (freed on reset) so things keep working, debug builds warn about it.
+static constexpr size_t k_frameArenaSize = NK_KB_TO_BYTES(256);
+
+struct FrameArenaStats
+{
+    size_t used;      // Bytes used during the last frame.
+    size_t highWater; // Most bytes ever used in a single frame.
+    size_t overflows; // Allocations that didn't fit and went to the heap during the last frame.
+};
+
+static void* FrameAlloc(size_t bytes, size_t alignment = alignof(std::max_align_t));
+static void ResetFrameArena();
+static const FrameArenaStats& GetFrameArenaStats();
+
+// Formats a string into frame memory, the result is only valid until the arena is next reset.
+static std::string_view FrameFormat(const char* format, ...);
+
+// Small fixed-size types can opt into being allocated from a per-type pool by using DECLARE_MEMORY_POOL,
+// which must come before the first Allocate of that type. Pooled objects are stored in fixed size blocks
+// so pointers remain stable, and freed slots are reused through a free list.
+template<typename T>
+struct MemoryPoolTraits
+{
+    static constexpr bool k_pooled = false;
+};
+
+#define DECLARE_MEMORY_POOL(name)           \
+template<>                                  \
+struct MemoryPoolTraits<name##__Type>       \
+{                                           \
+    static constexpr bool k_pooled = true;  \
+}
+
 template<typename T>
 static T* Allocate(const MemoryTag& tag);
 template<typename T>
@@ -15,9 +15,13 @@ static void UpdateMenuOptions(MenuOption* options, size_t count, f32 dt)
         option.targetScale = (option.selected) ? 1.33f : 1.0f;
         option.scale = nk_lerp(option.scale, option.targetScale, 0.5f);
 
+        // Snap once close enough so the option settles and stops needing its geometry rebuilt.
+        if(fabsf(option.scale - option.targetScale) < 0.001f)
+            option.scale = option.targetScale;
+
         // If the option went from non-selected to selected then play a sound.
         if(option.selected && (oldSelected != option.selected))
-            PlaySound("click");
+            PlaySound(s_clickSound, 0, SoundPriority_Low, 2);
     }
 
     // Handle the interaction logic based on what type of option it is.
@@ -34,7 +38,7 @@ static void UpdateMenuOptions(MenuOption* options, size_t count, f32 dt)
                 {
                     if(leftPressed)
                     {
-                        PlaySound("select");
+                        PlaySound(s_selectSound);
                         option.scale = 2.0f;
                         option.toggle = !option.toggle;
                         if(option.action)
@@ -43,7 +47,7 @@ static void UpdateMenuOptions(MenuOption* options, size_t count, f32 dt)
                 }
                 else if(option.type == MenuOptionType_Slider)
                 {
-                    PlaySound("select");
+                    PlaySound(s_selectSound, 0, SoundPriority_Low, 2); // Plays every tick whilst dragging.
                     option.scale = 2.0f;
                     if(leftPressed)
                     {
@@ -66,6 +70,11 @@ static void UpdateMenuOptions(MenuOption* options, size_t count, f32 dt)
     }
 }
 
+static bool RectsEqual(const Rect& a, const Rect& b)
+{
+    return (a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h);
+}
+
 static void RenderMenuOption(MenuOption& option, f32 currAngle)
 {
     f32 xPos  = option.bounds.x + (option.bounds.w * 0.5f);
@@ -87,7 +96,23 @@ static void RenderMenuOption(MenuOption& option, f32 currAngle)
     {
         clip.y += (clip.h * roundf((option.slider*100.0f)/10.0f));
     }
-    imm::DrawBatchedTexture(xPos,yPos, scale,scale, nk_torad(angle), imm::Flip_None, NULL, &clip);
+
+    Rect region = imm::GetBatchRegion();
+    nkVec2 textureSize = imm::GetBatchTextureSize();
+
+    bool dirty = !option.quadBuilt || option.quadScale != scale || option.quadAngle != angle || !RectsEqual(option.quadClip, clip) ||
+        !RectsEqual(option.quadRegion, region) || option.quadTextureSize.x != textureSize.x || option.quadTextureSize.y != textureSize.y;
+    if(dirty)
+    {
+        imm::GetBatchedTextureQuad(option.quad, xPos,yPos, scale,scale, nk_torad(angle), imm::Flip_None, NULL, &clip);
+        option.quadClip = clip;
+        option.quadRegion = region;
+        option.quadTextureSize = textureSize;
+        option.quadScale = scale;
+        option.quadAngle = angle;
+        option.quadBuilt = true;
+    }
+    imm::PutVertices(option.quad, 6);
 }
 
 static void RenderMenuOptions(MenuOption* options, size_t count, f32 dt)
@@ -100,7 +125,7 @@ static void RenderMenuOptions(MenuOption* options, size_t count, f32 dt)
     s_timer += dt;
     s_angle = nk_sin_range(-10.0f, 10.0f, s_timer*2.5f);
 
-    imm::BeginTextureBatch("menu");
+    imm::BeginTextureBatch(s_menuTexture);
     for(size_t i=0; i<count; ++i)
         if(!options[i].selected)
             RenderMenuOption(options[i], s_angle);
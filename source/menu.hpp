@@ -24,6 +24,7 @@ struct MenuOption
         targetScale = 1.0f;
         toggle = false;
         slider = 1.0f;
+        quadBuilt = false;
     }
 
     MenuOptionAction action;
@@ -35,8 +36,22 @@ struct MenuOption
     f32 targetScale;
     bool toggle;
     f32 slider;
+
+    // Geometry is retained between frames and only rebuilt when the state it was built from changes,
+    // so an idle menu just re-puts the same vertices (see RenderMenuOption).
+    imm::Vertex quad[6];
+    Rect quadClip;
+    Rect quadRegion;
+    nkVec2 quadTextureSize;
+    f32 quadScale;
+    f32 quadAngle;
+    bool quadBuilt;
 };
 
+static AssetHandle<Texture> s_menuTexture("menu");
+static AssetHandle<Sound> s_clickSound("click");
+static AssetHandle<Sound> s_selectSound("select");
+
 static void UpdateMenuOptions(MenuOption* options, size_t count, f32 dt);
 static void RenderMenuOption(MenuOption& option, f32 currAngle);
 static void RenderMenuOptions(MenuOption* options, size_t count, f32 dt);
@@ -56,25 +56,24 @@ static void RenderCostumesMenu(f32 dt)
 
     // Draw the title.
     Rect titleClip = { 0,96,256,32 };
-    imm::DrawTexture("menu", halfW,24.0f, &titleClip);
+    imm::DrawTexture(s_menuTexture, halfW,24.0f, &titleClip);
 
     // Draw the costume.
-    f32 costumeOffset = 64 * NK_CAST(f32, s_rocket.costume);
     f32 nameOffset = 24 * NK_CAST(f32, s_rocket.costume);
 
-    Rect costumeClip = { 64+costumeOffset,0,64,64 };
+    s32 costumeVariant = NK_CAST(s32, s_rocket.costume) + 1;
     Rect nameClip = { 0,624+nameOffset,256,24 };
 
     if(!s_rocket.unlocks[s_rocket.costume])
     {
-        costumeClip.x = 0.0f;
+        costumeVariant = 0;
         nameClip.y += k_costumeLockedTextOffset;
     }
 
     s_costumeScale = nk_lerp(s_costumeScale, 1.0f, 0.5f);
 
-    imm::DrawTexture("costume", halfW,halfH, s_costumeScale,s_costumeScale, 0.0f, imm::Flip_None, NULL, &costumeClip);
-    imm::DrawTexture("menu", halfW,halfH+48, &nameClip);
+    imm::DrawPaletteTexture(s_costumeTexture, costumeVariant, halfW,halfH, s_costumeScale,s_costumeScale, 0.0f, imm::Flip_None);
+    imm::DrawTexture(s_menuTexture, halfW,halfH+48, &nameClip);
 }
 
 static void GoToCostumesMenu()
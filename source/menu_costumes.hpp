@@ -11,6 +11,8 @@ enum CostumesMenuOption
 static constexpr f32 k_costumeLockedTextOffset = 192.0f;
 static f32 s_costumeScale = 1.0f;
 
+static AssetHandle<PaletteTexture> s_costumeTexture("costume"); // Variant 0 is the locked costume, the rest follow the Costume order.
+
 static void UpdateCostumesMenu(f32 dt);
 static void RenderCostumesMenu(f32 dt);
 static void GoToCostumesMenu();
@@ -21,9 +21,14 @@ MenuOption(GameOverMenuActionRetry, MenuOptionType_Button, { 0.0f,248.0f,180.0f,
 MenuOption(GameOverMenuActionMenu,  MenuOptionType_Button, { 0.0f,272.0f,180.0f,24.0f }, { 0, 336,128,24 })
 };
 
+static void CreateGameOverMenu()
+{
+    s_gameOverUnlocks.reserve(Costume_TOTAL);
+}
+
 static void SetupNextUnlockState()
 {
-    PlaySound("unlock");
+    PlaySound(s_unlockSound);
     s_unlockCostumeScale = 0.0f;
     s_unlockRadialAlpha = 0.0f;
     s_unlockRadialScale = 0.0f;
@@ -86,30 +91,28 @@ static void RenderGameOverMenu(f32 dt)
             f32 halfW = GetScreenWidth() * 0.5f;
             f32 halfH = GetScreenHeight() * 0.5f;
 
-            f32 costumeOffset = 64 * NK_CAST(f32, costume);
             f32 nameOffset = 24 * NK_CAST(f32, costume);
 
-            Rect costumeClip = { 64+costumeOffset,0,64,64 };
             Rect nameClip = { 0,624+nameOffset,256,24 };
             Rect unlockClip = { 0,1784,256,24 };
 
-            nkVec4 color = { 1,1,1,s_unlockRadialAlpha };
+            nkVec4 color = imm::PremultiplyColor({ 1,1,1,s_unlockRadialAlpha });
 
-            imm::DrawTexture("radial", halfW,halfH, s_unlockRadialScale,s_unlockRadialScale, s_unlockRadialAngle, imm::Flip_None, NULL, NULL, color);
-            imm::DrawTexture("costume", halfW,halfH, s_unlockCostumeScale,s_unlockCostumeScale, nk_torad(s_unlockCostumeAngle), imm::Flip_None, NULL, &costumeClip);
-            imm::DrawTexture("menu", halfW,halfH + 80.0f, &nameClip);
-            imm::DrawTexture("menu", halfW,halfH + 96.0f, &unlockClip);
+            imm::DrawTexture(s_radialTexture, halfW,halfH, s_unlockRadialScale,s_unlockRadialScale, s_unlockRadialAngle, imm::Flip_None, NULL, NULL, color);
+            imm::DrawPaletteTexture(s_costumeTexture, NK_CAST(s32, costume) + 1, halfW,halfH, s_unlockCostumeScale,s_unlockCostumeScale, nk_torad(s_unlockCostumeAngle), imm::Flip_None);
+            imm::DrawTexture(s_menuTexture, halfW,halfH + 80.0f, &nameClip);
+            imm::DrawTexture(s_menuTexture, halfW,halfH + 96.0f, &unlockClip);
         }
     }
     else
     {
         RenderMenuOptions(s_gameOverMenuOptions, GameOverMenuOption_TOTAL, dt);
         Rect titleClip = { 0,1704,256,32 };
-        imm::DrawTexture("menu", GetScreenWidth()*0.5f,24.0f, &titleClip);
+        imm::DrawTexture(s_menuTexture, GetScreenWidth()*0.5f,24.0f, &titleClip);
 
         // Draw the score achieved.
         bool newHighscore = (s_rocket.score >= s_rocket.highscores[0]);
-        std::string scoreStr = std::to_string(s_rocket.score) + "!";
+        std::string_view scoreStr = FrameFormat("%u!", s_rocket.score);
         f32 textWidth = GetTextLineWidth(s_bigFont0, scoreStr);
         f32 screenWidth = GetScreenWidth();
         f32 screenHeight = GetScreenHeight();
@@ -125,7 +128,7 @@ static void RenderGameOverMenu(f32 dt)
         if(s_rocket.score >= s_rocket.highscores[9]) clip = wellDoneClip;
         if(s_rocket.score >= s_rocket.highscores[0]) clip = newHighClip;
 
-        imm::DrawTexture("menu", screenWidth*0.5f,textHeight+64.0f, &clip);
+        imm::DrawTexture(s_menuTexture, screenWidth*0.5f,textHeight+64.0f, &clip);
     }
 }
 
@@ -9,6 +9,10 @@ enum GameOverMenuOption
 
 static std::vector<Costume> s_gameOverUnlocks;
 
+static AssetHandle<Texture> s_radialTexture("radial");
+static AssetHandle<Sound> s_unlockSound("unlock");
+
+static void CreateGameOverMenu();
 static void UpdateGameOverMenu(f32 dt);
 static void RenderGameOverMenu(f32 dt);
 static void GoToGameOverMenu();
@@ -75,8 +75,8 @@ static void RenderMainMenu(f32 dt)
     s_scaleX = nk_sin_range(0.8f, 1.0f, s_timer*1.5f);
     s_scaleY = nk_sin_range(0.8f, 1.0f, s_timer*2.0f);
 
-    imm::DrawTexture("menu", halfW,48.0f, s_scaleX,s_scaleY, nk_torad(s_angle), imm::Flip_None, NULL, &titleClip);
-    imm::DrawTexture("menu", halfW,screenH-12.0f, &authorClip);
+    imm::DrawTexture(s_menuTexture, halfW,48.0f, s_scaleX,s_scaleY, nk_torad(s_angle), imm::Flip_None, NULL, &titleClip);
+    imm::DrawTexture(s_menuTexture, halfW,screenH-12.0f, &authorClip);
 }
 
 static void GoToMainMenu()
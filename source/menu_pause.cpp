@@ -24,7 +24,7 @@ MenuOption(PauseMenuActionMenu,     MenuOptionType_Button, { 0.0f,248.0f,180.0f,
 static void PauseGame()
 {
     s_gamePaused = true;
-    PlaySound("pause");
+    PlaySound(s_pauseSound);
     PauseMusic();
     StopThruster();
     ResetCursor();
@@ -34,7 +34,7 @@ static void PauseGame()
 static void ResumeGame()
 {
     s_gamePaused = false;
-    PlaySound("pause");
+    PlaySound(s_pauseSound);
     ResumeMusic();
     StartThruster();
 }
@@ -80,7 +80,7 @@ static void RenderPauseMenu(f32 dt)
 
     static Rect s_pauseClip = { 0,160,256,32 };
 
-    imm::DrawTexture("menu", halfW,halfH-40, &s_pauseClip);
+    imm::DrawTexture(s_menuTexture, halfW,halfH-40, &s_pauseClip);
     RenderMenuOptions(s_pauseMenuOptions, PauseMenuOption_TOTAL, dt);
 }
 
@@ -8,6 +8,8 @@ enum PauseMenuOption
     PauseMenuOption_TOTAL
 };
 
+static AssetHandle<Sound> s_pauseSound("pause");
+
 static void PauseGame();
 static void ResumeGame();
 
@@ -23,7 +23,7 @@ static void RenderScoresMenu(f32 dt)
     if(s_gameState != GameState_ScoresMenu) return;
     RenderMenuOptions(s_scoresMenuOptions, ScoresMenuOption_TOTAL, dt);
     Rect titleClip = { 0,64,256,32 };
-    imm::DrawTexture("menu", GetScreenWidth()*0.5f,24.0f, &titleClip);
+    imm::DrawTexture(s_menuTexture, GetScreenWidth()*0.5f,24.0f, &titleClip);
 
     // Draw the highscores.
     f32 screenWidth = GetScreenWidth();
@@ -34,17 +34,11 @@ static void RenderScoresMenu(f32 dt)
         BitmapFont* font = (i == 0) ? &s_font1 : &s_font0;
         u32 score = s_rocket.highscores[i];
 
-        std::string scoreStr = std::to_string(score);
-        if(score == 0)
+        std::string_view scoreStr = "______";
+        if(score != 0)
         {
-            scoreStr = "______";
-        }
-        else
-        {
-            while(scoreStr.length() < 6)
-            {
-                scoreStr = "_" + scoreStr;
-            }
+            s32 digits = snprintf(NULL, 0, "%u", score);
+            scoreStr = FrameFormat("%.*s%u", std::max(6-digits,0), "______", score);
         }
 
         f32 textWidth = GetTextLineWidth(*font, scoreStr);
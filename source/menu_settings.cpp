@@ -20,7 +20,7 @@ static void SettingsMenuActionResetSave(MenuOption& option)
     if(s_resetSaveCounter >= 3)
     {
         s_resetSaveCounter = 0;
-        PlaySound("reset");
+        PlaySound(s_resetSound);
         ResetSave();
     }
 }
@@ -59,7 +59,7 @@ static void RenderSettingsMenu(f32 dt)
     if(s_gameState != GameState_SettingsMenu) return;
     RenderMenuOptions(s_settingsMenuOptions, SettingsMenuOption_TOTAL, dt);
     Rect titleClip = { 0,128,256,32 };
-    imm::DrawTexture("menu", GetScreenWidth()*0.5f,24.0f, &titleClip);
+    imm::DrawTexture(s_menuTexture, GetScreenWidth()*0.5f,24.0f, &titleClip);
 }
 
 static void GoToSettingsMenu()
@@ -2,6 +2,8 @@
 
 static s32 s_resetSaveCounter;
 
+static AssetHandle<Sound> s_resetSound("reset");
+
 enum SettingsMenuOption
 {
     SettingsMenuOption_Sound,
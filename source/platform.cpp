@@ -203,10 +203,11 @@ static void UpdateInputState()
             s_context.input.currentButtonState[i] = (sdlButton != 0);
         }
         // Axis state.
+        memcpy(s_context.input.previousAxisState, s_context.input.currentAxisState, sizeof(s_context.input.previousAxisState));
         for(s32 i=0; i<GamepadAxis_TOTAL; ++i)
         {
             s16 sdlAxis = SDL_GameControllerGetAxis(s_context.gamepad, MapGamepadAxisToSDLGameControllerAxis(NK_CAST(GamepadAxis, i)));
-            s_context.input.currentButtonState[i] = sdlAxis;
+            s_context.input.currentAxisState[i] = sdlAxis;
         }
     }
     else
@@ -216,6 +217,15 @@ static void UpdateInputState()
         memset(s_context.input.previousAxisState, 0, sizeof(s_context.input.previousAxisState));
         memset(s_context.input.currentAxisState, 0, sizeof(s_context.input.currentAxisState));
     }
+
+    // Track when there was last any input so the app can tell when the player has left it alone.
+    bool anyInput = (s_context.input.relativeMousePos.x != 0.0f || s_context.input.relativeMousePos.y != 0.0f);
+    for(s32 i=0; i<KeyCode_TOTAL; ++i) anyInput |= s_context.input.currentKeyState[i];
+    for(s32 i=0; i<MouseButton_TOTAL; ++i) anyInput |= s_context.input.currentMouseButtonState[i];
+    for(s32 i=0; i<GamepadButton_TOTAL; ++i) anyInput |= s_context.input.currentButtonState[i];
+    for(s32 i=0; i<GamepadAxis_TOTAL; ++i) anyInput |= (abs(s_context.input.currentAxisState[i]) > k_gamepadStickDeadzone);
+    if(anyInput)
+        s_context.input.lastInputTime = SDL_GetTicks();
 }
 
 static f32 CounterToSeconds(u64 counter, u64 frequency)
@@ -448,11 +458,13 @@ static std::vector<u8> ReadBinaryFile(std::string fileName)
     return data;
 }
 
-static void WriteBinaryFile(std::string fileName, void* data, size_t size)
+static bool WriteBinaryFile(std::string fileName, void* data, size_t size)
 {
     std::ofstream file(fileName, std::ios::binary);
-    if(!file.is_open()) return;
+    if(!file.is_open()) return false;
     file.write(NK_CAST(const char*, data), size);
+    file.close();
+    return !file.fail();
 }
 
 static void ListPathFiles(std::string pathName, std::vector<std::string>& files, bool recursive)
@@ -12,6 +12,7 @@ struct InputState
     bool   currentButtonState[GamepadButton_TOTAL];
     s16    previousAxisState[GamepadAxis_TOTAL];
     s16    currentAxisState[GamepadAxis_TOTAL];
+    u32    lastInputTime; // SDL ticks of the last update that had any input.
 };
 
 static const AppConfig& GetAppConfig();
@@ -59,7 +60,7 @@ static std::string     GetFilePath(std::string fileName);
 static std::string     ReadEntireFile(std::string fileName);
 static void            WriteEntireFile(std::string fileName, std::string content);
 static std::vector<u8> ReadBinaryFile(std::string fileName);
-static void            WriteBinaryFile(std::string fileName, void* data, size_t size);
+static bool            WriteBinaryFile(std::string fileName, void* data, size_t size); // Returns false if the file couldn't be fully written.
 static void            ListPathFiles(std::string pathName, std::vector<std::string>& files, bool recursive);
 
 // Returns a structure with all the raw information about the input for this frame. It is best to not
@@ -1,20 +1,19 @@
 static void StartThruster()
 {
     if(s_rocket.thruster != k_invalidSoundRef) return;
-    std::string thruster;
-    thruster = "thruster";
+    AssetHandle<Sound>* thruster = &s_thrusterSound;
     switch(s_rocket.costume)
     {
-        case Costume_Meat: thruster = "squirt"; break;
-        case Costume_Doodle: thruster = "mouth0"; break;
-        case Costume_Rainbow: thruster = "sparkle"; break;
-        case Costume_Glitch: thruster = "static"; break;
+        case Costume_Meat: thruster = &s_squirtSound; break;
+        case Costume_Doodle: thruster = &s_mouth0Sound; break;
+        case Costume_Rainbow: thruster = &s_sparkleSound; break;
+        case Costume_Glitch: thruster = &s_staticSound; break;
         default:
         {
             // Nothing...
         } break;
     }
-    s_rocket.thruster = PlaySound(thruster, -1);
+    s_rocket.thruster = PlaySound(*thruster, -1, SoundPriority_Critical);
 }
 
 static void StopThruster()
@@ -34,6 +33,7 @@ static void CreateRocket()
     s_rocket.score = 0;
     s_rocket.frame = 0;
     s_rocket.dead  = true;
+    s_rocket.hit   = false;
     s_rocket.collider = { { 0,-8 }, 8.0f };
     s_rocket.collector = { { 0,-8 }, 40.0f };
     s_rocket.costume = Costume_Red;
@@ -57,22 +57,23 @@ static void HitRocket()
 
     SpawnSmoke(SmokeType_Explosion, s_rocket.pos.x, s_rocket.pos.y, RandomS32(20,40));
 
-    std::string explosion = "explosion";
+    AssetHandle<Sound>* explosion = &s_explosionSound;
     switch(s_rocket.costume)
     {
-        case Costume_Meat: explosion = "splat"; break;
-        case Costume_Doodle: explosion = "mouth2"; break;
-        case Costume_Rainbow: explosion = "ignite"; break;
-        case Costume_Glitch: explosion = "glitch"; break;
+        case Costume_Meat: explosion = &s_splatSound; break;
+        case Costume_Doodle: explosion = &s_mouth2Sound; break;
+        case Costume_Rainbow: explosion = &s_igniteSound; break;
+        case Costume_Glitch: explosion = &s_glitchSound; break;
         default:
         {
             // Nothing...
         } break;
     }
-    PlaySound(explosion);
+    PlaySound(*explosion, 0, SoundPriority_High);
 
     s_rocket.timer = 0.0f;
     s_rocket.dead = true;
+    s_rocket.hit = false;
 
     StopMusic();
 
@@ -142,19 +143,19 @@ static void UpdateRocket(f32 dt)
             {
                 if(s_canPlayWhoosh)
                 {
-                    std::string whoosh = "whoosh";
+                    AssetHandle<Sound>* whoosh = &s_whooshSound;
                     switch(s_rocket.costume)
                     {
-                        case Costume_Meat: whoosh = "squelch"; SpawnSmoke(SmokeType_Small, s_rocket.pos.x, s_rocket.pos.y, RandomS32(2,5)); break;
-                        case Costume_Doodle: whoosh = "mouth1"; break;
-                        case Costume_Rainbow: whoosh = "magic"; break;
-                        case Costume_Glitch: whoosh = "fuzz"; break;
+                        case Costume_Meat: whoosh = &s_squelchSound; SpawnSmoke(SmokeType_Small, s_rocket.pos.x, s_rocket.pos.y, RandomS32(2,5)); break;
+                        case Costume_Doodle: whoosh = &s_mouth1Sound; break;
+                        case Costume_Rainbow: whoosh = &s_magicSound; break;
+                        case Costume_Glitch: whoosh = &s_fuzzSound; break;
                         default:
                         {
                             // Nothing...
                         } break;
                     }
-                    PlaySound(whoosh);
+                    PlaySound(*whoosh, 0, SoundPriority_Low, 2);
                     s_whooshVel = s_rocket.vel.x;
                     s_canPlayWhoosh = false;
                 }
@@ -199,7 +200,8 @@ static void UpdateRocket(f32 dt)
             {
                 if(CheckCollision(s_rocket.pos, s_rocket.collider, asteroid.pos, asteroid.collider))
                 {
-                    HitRocket();
+                    // Dying saves the game, that can't happen inside the no-alloc scope so it's handled after.
+                    s_rocket.hit = true;
                     return;
                 }
             }
@@ -213,7 +215,7 @@ static void UpdateRocket(f32 dt)
             if(s_rocket.score > 999999)
                 s_rocket.score = 999999;
             if(s_rocket.highscores[0] != 0 && oldScore <= s_rocket.highscores[0] && s_rocket.score > s_rocket.highscores[0])
-                PlaySound("highscore");
+                PlaySound(s_highscoreSound);
         }
     }
 }
@@ -228,8 +230,8 @@ static void RenderRocket(f32 dt)
             f32 frame = floorf(s_rocket.timer / 0.04f);
             if(frame < 13)
             {
-                imm::BeginTextureBatch("explosion");
-                Rect clip = { 96*frame, 96*NK_CAST(f32, s_rocket.costume), 96, 96 };
+                imm::BeginPaletteTextureBatch(s_explosionTexture, s_rocket.costume);
+                Rect clip = { 96*frame, 0, 96, 96 };
                 imm::DrawBatchedTexture(s_rocket.pos.x, s_rocket.pos.y, &clip);
                 if(s_rocket.costume != Costume_Doodle)
                 {
@@ -242,16 +244,15 @@ static void RenderRocket(f32 dt)
         else
         {
             // Draw the rocket.
-            Rect clip = { 48*NK_CAST(f32,s_rocket.frame), 96*NK_CAST(f32,s_rocket.costume), 48, 96 };
+            Rect clip = { 48*NK_CAST(f32,s_rocket.frame), 0, 48, 96 };
             f32 angle = nk_torad(s_rocket.angle + s_rocket.shake);
-            imm::DrawTexture("rocket", s_rocket.pos.x, s_rocket.pos.y, 1.0f, 1.0f, angle, imm::Flip_None, NULL, &clip);
+            imm::DrawPaletteTexture(s_rocketTexture, s_rocket.costume, s_rocket.pos.x, s_rocket.pos.y, 1.0f, 1.0f, angle, imm::Flip_None, NULL, &clip);
 
             // Draw the score.
             bool beatHighscore = ((s_rocket.score > s_rocket.highscores[0]) && (s_rocket.highscores[0] != 0));
             BitmapFont* font = (beatHighscore) ? &s_font1 : &s_font0;
-            std::string scoreStr = std::to_string(s_rocket.score);
-            f32 textWidth = GetTextLineWidth(*font, scoreStr);
-            if(beatHighscore) scoreStr += "!";
+            std::string_view scoreStr = FrameFormat("%u%s", s_rocket.score, (beatHighscore) ? "!" : "");
+            f32 textWidth = GetTextLineWidth(*font, scoreStr.substr(0, scoreStr.length()-((beatHighscore) ? 1 : 0)));
             f32 screenWidth = GetScreenWidth();
             f32 screenHeight = GetScreenHeight();
             DrawBitmapFont(*font, roundf((screenWidth-textWidth)*0.5f),4.0f, scoreStr);
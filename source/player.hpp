@@ -26,6 +26,7 @@ struct Rocket
     u32 score;
     s32 frame;
     bool dead;
+    bool hit;
     Collider collider;
     Collider collector;
     SoundRef thruster;
@@ -61,6 +62,26 @@ static constexpr f32 k_rocketMaxShake = 2.0f;
 static Rocket s_rocket;
 static Costume s_currentCostume;
 
+static AssetHandle<PaletteTexture> s_rocketTexture("rocket");
+static AssetHandle<PaletteTexture> s_explosionTexture("explosion");
+
+static AssetHandle<Sound> s_thrusterSound("thruster");
+static AssetHandle<Sound> s_squirtSound("squirt");
+static AssetHandle<Sound> s_mouth0Sound("mouth0");
+static AssetHandle<Sound> s_sparkleSound("sparkle");
+static AssetHandle<Sound> s_staticSound("static");
+static AssetHandle<Sound> s_explosionSound("explosion");
+static AssetHandle<Sound> s_splatSound("splat");
+static AssetHandle<Sound> s_mouth2Sound("mouth2");
+static AssetHandle<Sound> s_igniteSound("ignite");
+static AssetHandle<Sound> s_glitchSound("glitch");
+static AssetHandle<Sound> s_whooshSound("whoosh");
+static AssetHandle<Sound> s_squelchSound("squelch");
+static AssetHandle<Sound> s_mouth1Sound("mouth1");
+static AssetHandle<Sound> s_magicSound("magic");
+static AssetHandle<Sound> s_fuzzSound("fuzz");
+static AssetHandle<Sound> s_highscoreSound("highscore");
+
 static void StartThruster();
 static void StopThruster();
 static void CreateRocket();
@@ -14,9 +14,28 @@
 #include <filesystem>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <stack>
 #include <random>
 #include <iomanip>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <string_view>
+
+#if defined(BUILD_DEBUG) && defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <SDL.h>
 #include <SDL_mixer.h>
@@ -32,7 +51,7 @@
 #include <glew.c>
 #include <gon.cpp>
 #else
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include <emscripten.h>
 #endif
 
@@ -57,7 +76,9 @@ static bool s_gameResetting;
 #include "memory.hpp"
 #include "input.hpp"
 #include "assets.hpp"
+#include "vfs.hpp"
 #include "audio.hpp"
+#include "audio_render.hpp"
 #include "graphics.hpp"
 #include "platform.hpp"
 #include "collision.hpp"
@@ -80,8 +101,10 @@ static bool s_gameResetting;
 #include "utility.cpp"
 #include "memory.cpp"
 #include "input.cpp"
+#include "vfs.cpp"
 #include "assets.cpp"
 #include "audio.cpp"
+#include "audio_render.cpp"
 #include "graphics.cpp"
 #include "platform.cpp"
 #include "collision.cpp"
@@ -101,6 +124,12 @@ static bool s_gameResetting;
 #include "menu_gameover.cpp"
 #include "menu_pause.cpp"
 
+// The actual game loop should never need to touch the heap, debug builds can enforce this with -zeroalloc.
+static bool IsGameplayActive()
+{
+    return ((s_gameState == GameState_Game) && !s_gamePaused && !s_gameResetting && !s_rocket.dead);
+}
+
 class RocketApp: public Application
 {
 public:
@@ -110,6 +139,7 @@ public:
         SetScreenFilter(Filter_Nearest);
 
         LoadAllAssetsOfType<Texture>();
+        LoadAllAssetsOfType<PaletteTexture>();
         LoadAllAssetsOfType<Shader>();
         LoadAllAssetsOfType<Sound>();
         LoadAllAssetsOfType<Music>();
@@ -123,16 +153,23 @@ public:
 
         ShowCursor(false);
 
+        // These are on screen all of the time so there's no point letting them be evicted.
+        AcquireAsset(s_backTexture);
+        AcquireAsset(s_menuTexture);
+        AcquireAsset(s_cursorTexture);
+
         CreateBackground();
         CreateRocket();
+        CreateAsteroids();
         CreateSmoke();
+        CreateGameOverMenu();
 
         LoadBitmapFont(   s_font0, 14,24,    "font0");
         LoadBitmapFont(   s_font1, 14,24,    "font1");
         LoadBitmapFont(s_bigFont0, 24,40, "bigfont0");
         LoadBitmapFont(s_bigFont1, 24,40, "bigfont1");
 
-        PlayMusic("menu", -1);
+        PlayMusic(s_menuMusic, -1);
 
         s_gameState = GameState_MainMenu;
         s_gamePaused = false;
@@ -141,10 +178,23 @@ public:
     void OnQuit() override
     {
         SaveGame();
+        FlushSaveGame();
+
+        FreeBitmapFont(s_bigFont1);
+        FreeBitmapFont(s_bigFont0);
+        FreeBitmapFont(s_font1);
+        FreeBitmapFont(s_font0);
+
+        ReleaseAsset(s_cursorTexture);
+        ReleaseAsset(s_menuTexture);
+        ReleaseAsset(s_backTexture);
     }
 
     void OnUpdate(f32 dt) override
     {
+        bool gameplay = IsGameplayActive();
+        if(gameplay) BeginNoAllocScope();
+
         UpdateCursor(dt);
 
         if(!s_gameUnfocused)
@@ -176,10 +226,31 @@ public:
         }
 
         s_gameFrame++;
+
+        if(gameplay) EndNoAllocScope();
+        if(s_rocket.hit) HitRocket();
+
+        // Let the engine save power when not much is going on. Nothing changes whilst the game is unfocused
+        // and a menu that has been left alone is just the background scrolling, so that can tick slower.
+        static constexpr f32 k_idleMenuTime = 10.0f;
+        if(s_gameUnfocused)
+            m_powerMode = PowerMode_Sleep;
+        else if((s_gameState != GameState_Game) && (GetInputIdleTime() >= k_idleMenuTime))
+            m_powerMode = PowerMode_Idle;
+        else
+            m_powerMode = PowerMode_Active;
     }
 
     void OnRender(f32 dt) override
     {
+        bool gameplay = IsGameplayActive();
+        if(gameplay) BeginNoAllocScope();
+        NK_DEFER(if(gameplay) EndNoAllocScope());
+
+        // Lets the sprites and fonts drawn by the different systems share draw calls.
+        imm::BeginMultiTextureBatch();
+        NK_DEFER(imm::EndMultiTextureBatch());
+
         RenderBackground(dt);
         RenderSmoke(dt);
         RenderAsteroids(dt);
@@ -204,5 +275,19 @@ AppConfig AppMain(int argc, char** argv)
     appConfig.window.min  = { 180,320 };
     appConfig.screenSize  = { 180,320 };
     appConfig.app = Allocate<RocketApp>(MEM_GAME);
+
+    for(s32 i=1; i<argc; ++i)
+    {
+        if(strcmp(argv[i], "-zeroalloc") == 0)
+            SetZeroAllocMode(true);
+        else if(strcmp(argv[i], "-recordaudio") == 0 && i+1 < argc)
+            appConfig.audioRecordFile = argv[++i];
+        else if(strcmp(argv[i], "-renderaudio") == 0 && i+2 < argc)
+        {
+            appConfig.audioRenderSession = argv[++i];
+            appConfig.audioRenderOutput = argv[++i];
+        }
+    }
+
     return appConfig;
 }
@@ -5,7 +5,7 @@
 // u8      - Costume Unlocks as Bitflags
 // u32[10] - Highscores
 
-static void SaveGame()
+static std::string GetSaveFileName()
 {
     #ifdef __EMSCRIPTEN__
     std::string fileName = "/ROCKET/";
@@ -13,37 +13,146 @@ static void SaveGame()
     std::string fileName = GetExecPath();
     #endif
 
-    fileName += k_saveFileName;
+    return fileName + k_saveFileName;
+}
+
+static void SerializeSave(std::vector<u8>& data)
+{
+    u8 currentCostume = (s_rocket.random) ? NK_CAST(u8, Costume_Random) : NK_CAST(u8, s_rocket.costume);
+    u8 unlockFlags = UnlockFlags_None;
+
+    if(s_rocket.unlocks[Costume_Happy  ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Happy);
+    if(s_rocket.unlocks[Costume_Sad    ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Sad);
+    if(s_rocket.unlocks[Costume_Sick   ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Sick);
+    if(s_rocket.unlocks[Costume_Meat   ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Meat);
+    if(s_rocket.unlocks[Costume_Doodle ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Doodle);
+    if(s_rocket.unlocks[Costume_Rainbow]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Rainbow);
+    if(s_rocket.unlocks[Costume_Glitch ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Glitch);
+
+    auto Write = [&data](const void* value, size_t bytes)
+    {
+        const u8* ptr = NK_CAST(const u8*, value);
+        data.insert(data.end(), ptr, ptr+bytes);
+    };
+
+    data.clear();
+    Write(&k_saveVersion, sizeof(k_saveVersion));
+    Write(&currentCostume, sizeof(currentCostume));
+    Write(&unlockFlags, sizeof(unlockFlags));
+    for(s32 i=0; i<10; ++i)
+        Write(&s_rocket.highscores[i], sizeof(s_rocket.highscores[i]));
+}
+
+// The data is written next to the save and flushed to disk before being moved over it, so a crash or power
+// loss mid-write leaves either the old save or the new one rather than a truncated file.
+static void WriteSaveFile(const std::vector<u8>& data)
+{
+    std::string fileName = GetSaveFileName();
+    std::string tempFileName = fileName + ".tmp";
 
-    FILE* file = fopen(fileName.c_str(), "wb");
+    FILE* file = fopen(tempFileName.c_str(), "wb");
     if(!file)
+    {
+        printf("Failed to save game data!\n");
+        return;
+    }
+    bool written = (fwrite(data.data(), 1, data.size(), file) == data.size());
+    written = (fflush(file) == 0) && written;
+    #ifdef _WIN32
+    written = (_commit(_fileno(file)) == 0) && written;
+    #else
+    written = (fsync(fileno(file)) == 0) && written;
+    #endif
+    written = (fclose(file) == 0) && written;
+
+    std::error_code error;
+    if(written) std::filesystem::rename(tempFileName, fileName, error);
+    if(!written || error)
+    {
         printf("Failed to save game data!\n");
-    else
+        std::filesystem::remove(tempFileName, error);
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+static void SaveWriterThread()
+{
+    std::unique_lock<std::mutex> lock(s_saveWriter.mutex);
+    while(true)
     {
-        u8 currentCostume = (s_rocket.random) ? NK_CAST(u8, Costume_Random) : NK_CAST(u8, s_rocket.costume);
-        u8 unlockFlags = UnlockFlags_None;
-
-        if(s_rocket.unlocks[Costume_Happy  ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Happy);
-        if(s_rocket.unlocks[Costume_Sad    ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Sad);
-        if(s_rocket.unlocks[Costume_Sick   ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Sick);
-        if(s_rocket.unlocks[Costume_Meat   ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Meat);
-        if(s_rocket.unlocks[Costume_Doodle ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Doodle);
-        if(s_rocket.unlocks[Costume_Rainbow]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Rainbow);
-        if(s_rocket.unlocks[Costume_Glitch ]) NK_SET_FLAGS(unlockFlags, UnlockFlags_Glitch);
-
-        fwrite(&k_saveVersion, sizeof(k_saveVersion), 1, file);
-        fwrite(&currentCostume, sizeof(currentCostume), 1, file);
-        fwrite(&unlockFlags, sizeof(unlockFlags), 1, file);
-        for(s32 i=0; i<10; ++i)
-            fwrite(&s_rocket.highscores[i], sizeof(s_rocket.highscores[i]), 1, file);
-
-        fclose(file);
-
-        #ifdef __EMSCRIPTEN__
-        EM_ASM(FS.syncfs(function(err) { assert(!err); }));
-        #endif // __EMSCRIPTEN__
+        s_saveWriter.wake.wait(lock, []() { return s_saveWriter.dirty || s_saveWriter.quit; });
+        if(!s_saveWriter.dirty) break; // Only quit once everything has been written.
+
+        std::swap(s_saveWriter.pending, s_saveWriter.writing);
+        s_saveWriter.dirty = false;
+
+        lock.unlock();
+        WriteSaveFile(s_saveWriter.writing);
+        lock.lock();
     }
 }
+#endif // __EMSCRIPTEN__
+
+static void SaveGame()
+{
+    #ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard<std::mutex> lock(s_saveWriter.mutex);
+        SerializeSave(s_saveWriter.pending);
+        s_saveWriter.dirty = true;
+        if(!s_saveWriter.thread.joinable())
+        {
+            s_saveWriter.quit = false;
+            s_saveWriter.thread = std::thread(SaveWriterThread);
+            // Destroying the thread whilst it's still joinable would terminate, so make sure it's always joined
+            // on the way out even if we exit without OnQuit having been called.
+            if(!s_saveWriter.joinAtExit)
+                s_saveWriter.joinAtExit = (atexit(FlushSaveGame) == 0);
+        }
+    }
+    s_saveWriter.wake.notify_one();
+    #else
+    // There are no threads on the web and the write only goes to MEMFS, it's the sync to IndexedDB that's slow,
+    // so that gets held off until the saves settle down (or the page gets hidden, as it may be about to close).
+    static std::vector<u8> data;
+    SerializeSave(data);
+    WriteSaveFile(data);
+    EM_ASM
+    ({
+        if(!Module.saveSync)
+        {
+            Module.saveSync = function()
+            {
+                if(!Module.saveSyncTimer) return;
+                clearTimeout(Module.saveSyncTimer);
+                Module.saveSyncTimer = null;
+                FS.syncfs(function(err) { assert(!err); });
+            };
+            document.addEventListener("visibilitychange", function()
+            {
+                if(document.visibilityState === "hidden") Module.saveSync();
+            });
+        }
+        if(Module.saveSyncTimer) clearTimeout(Module.saveSyncTimer);
+        Module.saveSyncTimer = setTimeout(Module.saveSync, $0);
+    }, k_saveSyncDelay);
+    #endif // __EMSCRIPTEN__
+}
+
+static void FlushSaveGame()
+{
+    #ifndef __EMSCRIPTEN__
+    if(!s_saveWriter.thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(s_saveWriter.mutex);
+        s_saveWriter.quit = true;
+    }
+    s_saveWriter.wake.notify_one();
+    s_saveWriter.thread.join();
+    #else
+    EM_ASM(if(Module.saveSync) Module.saveSync(););
+    #endif // __EMSCRIPTEN__
+}
 
 static void LoadGame()
 {
@@ -54,13 +163,7 @@ static void LoadGame()
     s_rocket.unlocks[Costume_Random] = true;
 
     // Load data if available.
-    #ifdef __EMSCRIPTEN__
-    std::string fileName = "/ROCKET/";
-    #else
-    std::string fileName = GetExecPath();
-    #endif
-
-    fileName += k_saveFileName;
+    std::string fileName = GetSaveFileName();
 
     if(DoesFileExist(fileName))
     {
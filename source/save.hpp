@@ -15,6 +15,27 @@ enum UnlocksFlags : u8
     UnlockFlags_Glitch  = 1 << 6
 };
 
+// Saves are serialized on the game thread and handed off to be written out in the background, anything saved
+// while a write is still in flight replaces whatever was waiting so only the latest state ever hits the disk.
+#ifndef __EMSCRIPTEN__
+struct SaveWriter
+{
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::thread             thread;
+    std::vector<u8>         pending;
+    std::vector<u8>         writing;
+    bool                    dirty = false;
+    bool                    quit = false;
+    bool                    joinAtExit = false; // Whether FlushSaveGame has been registered with atexit.
+};
+
+static SaveWriter s_saveWriter;
+#else
+static constexpr s32 k_saveSyncDelay = 1000; // Milliseconds to wait for more saves before syncing IDBFS.
+#endif // __EMSCRIPTEN__
+
 static void SaveGame();
 static void LoadGame();
 static void ResetSave();
+static void FlushSaveGame(); // Blocks until all saves have been written (and synced).
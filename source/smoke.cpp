@@ -98,10 +98,10 @@ static void UpdateSmoke(f32 dt)
 
 static void RenderSmoke(f32 dt)
 {
-    imm::BeginTextureBatch("smoke");
+    imm::BeginPaletteTextureBatch(s_smokeTexture, s_rocket.costume);
     for(auto& s: s_smoke)
     {
-        Rect clip = { NK_CAST(f32, 16*s.frame), 16*NK_CAST(f32, s_rocket.costume), 16, 16 };
+        Rect clip = { NK_CAST(f32, 16*s.frame), 0, 16, 16 };
         imm::DrawBatchedTexture(s.pos.x, s.pos.y, s.scale,s.scale, nk_torad(s.angle), imm::Flip_None, NULL, &clip);
     }
     imm::EndTextureBatch();
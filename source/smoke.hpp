@@ -27,6 +27,8 @@ struct Smoke
 
 static std::vector<Smoke> s_smoke;
 
+static AssetHandle<PaletteTexture> s_smokeTexture("smoke");
+
 static void CreateSmoke();
 static void SpawnSmoke(SmokeType type, f32 x, f32 y, s32 count);
 static void UpdateSmoke(f32 dt);
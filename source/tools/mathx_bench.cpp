@@ -0,0 +1,257 @@
+/*////////////////////////////////////////////////////////////////////////////*/
+
+// Checks the SIMD nkVec4/nkMat4 operations in nk_mathx against the scalar reference implementations
+// and then times the two against each other. Build with and without optimizations, and once with
+// NK_MATHX_NO_SIMD defined to sanity check the harness itself (everything should trivially match).
+
+#define NK_STATIC
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include <nk_define.h>
+#include <nk_mathx.h>
+
+static const int k_testCount = 100000;
+static const int k_benchCount = 1 << 20;
+static const float k_tolerance = 1e-4f;
+
+static int s_failures = 0;
+
+static float RandomFloat()
+{
+    return ((float)rand() / (float)RAND_MAX) * 200.0f - 100.0f;
+}
+
+static nkVec4 RandomVec4()
+{
+    return { RandomFloat(), RandomFloat(), RandomFloat(), RandomFloat() };
+}
+
+static nkVec4 RandomNonZeroVec4() // For the divisors.
+{
+    nkVec4 v = RandomVec4();
+    for(float& f: v.raw) if(fabsf(f) < 0.5f) f = 0.5f;
+    return v;
+}
+
+static nkMat4 RandomMat4()
+{
+    nkMat4 m;
+    for(float& f: m.raw) f = RandomFloat();
+    return m;
+}
+
+static bool NearlyEqual(const float* a, const float* b, int count, float scale)
+{
+    for(int i=0; i<count; ++i)
+        if(fabsf(a[i]-b[i]) > k_tolerance * fmaxf(1.0f, fmaxf(fabsf(b[i]), scale)))
+            return false;
+    return true;
+}
+
+static void Check(const char* name, bool passed)
+{
+    printf("%-24s %s\n", name, passed ? "passed" : "FAILED");
+    if(!passed) s_failures++;
+}
+
+// The scalar references for the nkVec4 operators are just the component-wise expressions.
+template<typename VecOp, typename ScalarOp>
+static void CheckVec4Op(const char* name, VecOp vecOp, ScalarOp scalarOp, bool divide)
+{
+    bool passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkVec4 a = RandomVec4();
+        nkVec4 b = (divide) ? RandomNonZeroVec4() : RandomVec4();
+        float s = (divide) ? RandomNonZeroVec4().x : RandomFloat();
+        nkVec4 v = vecOp(a, b);
+        nkVec4 vs = vecOp(a, s);
+        nkVec4 expected, expectedS;
+        for(int j=0; j<4; ++j)
+        {
+            expected.raw[j] = scalarOp(a.raw[j], b.raw[j]);
+            expectedS.raw[j] = scalarOp(a.raw[j], s);
+        }
+        passed = NearlyEqual(v.raw, expected.raw, 4, 0.0f) && NearlyEqual(vs.raw, expectedS.raw, 4, 0.0f);
+    }
+    Check(name, passed);
+}
+
+static void RunTests()
+{
+    printf("---- tests ----\n");
+
+    CheckVec4Op("nkVec4 add", [](nkVec4 a, auto b) { return a + b; }, [](float a, float b) { return a + b; }, false);
+    CheckVec4Op("nkVec4 sub", [](nkVec4 a, auto b) { return a - b; }, [](float a, float b) { return a - b; }, false);
+    CheckVec4Op("nkVec4 mul", [](nkVec4 a, auto b) { return a * b; }, [](float a, float b) { return a * b; }, false);
+    CheckVec4Op("nkVec4 div", [](nkVec4 a, auto b) { return a / b; }, [](float a, float b) { return a / b; }, true);
+
+    bool passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkVec4 a = RandomVec4(), b = RandomVec4();
+        float t = (float)rand() / (float)RAND_MAX;
+        nkVec4 v = nk_lerp(a, b, t);
+        nkVec4 expected = { a.x+t*(b.x-a.x), a.y+t*(b.y-a.y), a.z+t*(b.z-a.z), a.w+t*(b.w-a.w) };
+        passed = NearlyEqual(v.raw, expected.raw, 4, 100.0f);
+    }
+    Check("nk_lerp nkVec4", passed);
+
+    passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkMat4 a = RandomMat4(), b = RandomMat4();
+        nkMat4 m = a * b;
+        nkMat4 expected;
+        nk__m4_mul_scalar(a.raw, b.raw, expected.raw);
+        passed = NearlyEqual(m.raw, expected.raw, 16, 100.0f*100.0f);
+    }
+    Check("nkMat4 * nkMat4", passed);
+
+    passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkMat4 a = RandomMat4();
+        a *= a; // The result is allowed to alias the input.
+        nkMat4 b = a;
+        nkMat4 expected;
+        nk__m4_mul_scalar(b.raw, b.raw, expected.raw);
+        a *= a;
+        passed = NearlyEqual(a.raw, expected.raw, 16, 1e8f);
+    }
+    Check("nkMat4 *= (aliased)", passed);
+
+    passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkMat4 a = RandomMat4();
+        nkVec4 b = RandomVec4();
+        nkVec4 v = a * b;
+        nkVec4 expected;
+        nk__m4_mul_v4_scalar(a.raw, b.raw, expected.raw);
+        passed = NearlyEqual(v.raw, expected.raw, 4, 100.0f*100.0f);
+    }
+    Check("nkMat4 * nkVec4", passed);
+
+    // The sprite path chains these together so make sure a full transform still comes out the same.
+    passed = true;
+    for(int i=0; i<k_testCount && passed; ++i)
+    {
+        nkMat4 m = nk_m4_identity();
+        m = nk_translate(m, { RandomFloat(),RandomFloat(),0.0f });
+        m = nk_scale(m, { RandomFloat()*0.01f,RandomFloat()*0.01f,1.0f });
+        m = nk_rotate(m, { 0.0f,0.0f,1.0f }, RandomFloat());
+        m = nk_orthographic(0,320,180,0,0,1) * m;
+        nkVec4 p = { RandomFloat(),RandomFloat(),0.0f,1.0f };
+        nkVec4 v = m * p;
+        nkVec4 expected;
+        nk__m4_mul_v4_scalar(m.raw, p.raw, expected.raw);
+        passed = NearlyEqual(v.raw, expected.raw, 4, 100.0f);
+    }
+    Check("transform chain", passed);
+}
+
+template<typename Fn>
+static double Time(Fn fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double,std::nano>(end-start).count() / (double)k_benchCount;
+}
+
+static void Report(const char* name, double simd, double scalar)
+{
+    printf("%-24s %6.2fns %6.2fns %5.2fx\n", name, simd, scalar, scalar/simd);
+}
+
+static void RunBenchmarks()
+{
+    printf("---- benchmarks (ns/op: simd, scalar, speedup) ----\n");
+
+    std::vector<nkVec4> vecs(k_benchCount);
+    std::vector<nkMat4> mats(k_benchCount);
+    for(auto& v: vecs) v = RandomNonZeroVec4();
+    for(auto& m: mats) m = RandomMat4();
+
+    volatile float sink = 0.0f; // Keeps the optimizer from throwing the work away.
+
+    double simd = Time([&]()
+    {
+        nkVec4 acc = NK_V4_ZERO;
+        for(int i=0; i<k_benchCount; ++i) acc = nk_lerp(acc, vecs[i] * vecs[i] + vecs[i], 0.5f);
+        sink = sink + acc.x;
+    });
+    double scalar = Time([&]()
+    {
+        float acc[4] = { 0,0,0,0 };
+        for(int i=0; i<k_benchCount; ++i)
+            for(int j=0; j<4; ++j)
+                acc[j] = acc[j] + 0.5f * ((vecs[i].raw[j] * vecs[i].raw[j] + vecs[i].raw[j]) - acc[j]);
+        sink = sink + acc[0];
+    });
+    Report("nkVec4 mul+add+lerp", simd, scalar);
+
+    simd = Time([&]()
+    {
+        float acc = 0.0f;
+        for(int i=0; i<k_benchCount; ++i) acc += (mats[i] * mats[(i+1) & (k_benchCount-1)]).x00;
+        sink = sink + acc;
+    });
+    scalar = Time([&]()
+    {
+        float acc = 0.0f;
+        nkMat4 m;
+        for(int i=0; i<k_benchCount; ++i) nk__m4_mul_scalar(mats[i].raw, mats[(i+1) & (k_benchCount-1)].raw, m.raw), acc += m.x00;
+        sink = sink + acc;
+    });
+    Report("nkMat4 * nkMat4", simd, scalar);
+
+    simd = Time([&]()
+    {
+        nkVec4 acc = NK_V4_ZERO;
+        for(int i=0; i<k_benchCount; ++i) acc += mats[i] * vecs[i];
+        sink = sink + acc.x;
+    });
+    scalar = Time([&]()
+    {
+        nkVec4 acc = NK_V4_ZERO, v;
+        for(int i=0; i<k_benchCount; ++i)
+        {
+            nk__m4_mul_v4_scalar(mats[i].raw, vecs[i].raw, v.raw);
+            for(int j=0; j<4; ++j) acc.raw[j] += v.raw[j];
+        }
+        sink = sink + acc.x;
+    });
+    Report("nkMat4 * nkVec4", simd, scalar);
+}
+
+int main()
+{
+    #if defined(NK_MATHX_SSE)
+    printf("simd backend: sse\n");
+    #elif defined(NK_MATHX_NEON)
+    printf("simd backend: neon\n");
+    #elif defined(NK_MATHX_WASM)
+    printf("simd backend: wasm\n");
+    #else
+    printf("simd backend: none (scalar)\n");
+    #endif
+
+    srand(1234);
+
+    RunTests();
+    RunBenchmarks();
+
+    printf("%d failure(s)\n", s_failures);
+    return (s_failures == 0) ? 0 : 1;
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
@@ -5,12 +5,307 @@
 
 #define NK_STATIC
 
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+#include <map>
 
 #include <nk_npak.h>
+#include <stb_image.h>
+
+// Sprite sheets that store a full recolored copy of their sprites for every costume. These get cooked
+// into a palette texture (.ptex) that the game loads instead: variants that are palette swaps of each
+// other share a single channel index layout and each variant gets its own row in a palette, variants
+// with too many colors to index (e.g. the glitch costume) are stored in full color as a fallback.
+// The source sheets live outside of the asset root so that they don't get loaded or packed themselves.
+struct PaletteSheet
+{
+    const char* name;
+    int variants;
+    bool horizontal; // Whether the variants are laid out left-to-right instead of top-to-bottom.
+};
+
+static const PaletteSheet k_paletteSheets[] =
+{
+{ "rocket",    10, false },
+{ "smoke",     10, false },
+{ "explosion", 10, false },
+{ "costume",   12, true  }
+};
+
+static const uint32_t k_paletteTextureMagic = 0x58455450; // 'PTEX'
+static const uint32_t k_paletteTextureVersion = 1;
+static const uint32_t k_paletteSize = 256;
+
+// Must match the layout expected by LoadPaletteTextureFromData in the game. The header and variant table
+// are followed by a zlib stream containing the index layouts, then the palettes, then the full color data.
+struct PaletteTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t variantWidth;
+    uint32_t variantHeight;
+    uint32_t variantCount;
+    uint32_t layoutCount;
+    uint32_t directCount;
+    uint32_t payloadSize; // Uncompressed size of the payload.
+};
+
+struct PaletteTextureVariant
+{
+    int32_t layout; // Index layout used by the variant, or -1 if it is stored in full color.
+    int32_t direct; // Full color slot used by the variant, or -1 if it is indexed.
+};
+
+struct PaletteLayout
+{
+    std::vector<uint32_t> indices; // Per-pixel index into the palettes of the members.
+    std::vector<int> members;
+    uint32_t colors;
+};
+
+// Minimal zlib compressor (greedy LZ77 with fixed huffman codes) so the cooked data doesn't end up bigger
+// than the source PNGs. The game decompresses it using the zlib decoder that comes with stb_image.
+struct BitWriter
+{
+    std::vector<uint8_t> bytes;
+    uint32_t buffer = 0;
+    int count = 0;
+
+    void Write(uint32_t bits, int n)
+    {
+        buffer |= bits << count;
+        count += n;
+        while(count >= 8)
+        {
+            bytes.push_back((uint8_t)(buffer & 0xFF));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+    void WriteHuffman(uint32_t code, int n) // Huffman codes are stored most significant bit first.
+    {
+        uint32_t reversed = 0;
+        for(int i=0; i<n; ++i) reversed |= ((code >> i) & 1) << (n-1-i);
+        Write(reversed, n);
+    }
+    void Flush()
+    {
+        if(count > 0) Write(0, 8-count);
+    }
+};
+
+static void WriteFixedLiteral(BitWriter& writer, int value)
+{
+    if(value <= 143) writer.WriteHuffman(0x30 + value, 8);
+    else if(value <= 255) writer.WriteHuffman(0x190 + (value-144), 9);
+    else if(value <= 279) writer.WriteHuffman(value-256, 7);
+    else writer.WriteHuffman(0xC0 + (value-280), 8);
+}
+
+static std::vector<uint8_t> ZlibCompress(const std::vector<uint8_t>& data)
+{
+    static const int k_lengthBase[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    static const int k_lengthExtra[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    static const int k_distBase[] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    static const int k_distExtra[] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+    static const int k_windowSize = 32768;
+    static const int k_hashSize = 1 << 15;
+    static const int k_maxChain = 64;
+
+    BitWriter writer;
+    writer.Write(0x78, 8);
+    writer.Write(0x01, 8);
+    writer.Write(1, 1); // Final block.
+    writer.Write(1, 2); // Fixed huffman codes.
+
+    int size = (int)data.size();
+    std::vector<int> head(k_hashSize, -1);
+    std::vector<int> prev(size, -1);
+    auto Hash = [&](int i) { return ((data[i] << 10) ^ (data[i+1] << 5) ^ data[i+2]) & (k_hashSize-1); };
+
+    int i = 0;
+    while(i < size)
+    {
+        int bestLength = 0, bestDist = 0;
+        if(i+2 < size)
+        {
+            int chain = 0;
+            for(int j=head[Hash(i)]; j>=0 && i-j<=k_windowSize && chain<k_maxChain; j=prev[j], ++chain)
+            {
+                int length = 0;
+                while(length < 258 && i+length < size && data[j+length] == data[i+length]) length++;
+                if(length > bestLength) bestLength = length, bestDist = i-j;
+                if(length == 258) break;
+            }
+        }
+
+        int advance = 1;
+        if(bestLength >= 3)
+        {
+            int lc = 0; while(lc < 28 && k_lengthBase[lc+1] <= bestLength) lc++;
+            WriteFixedLiteral(writer, 257+lc);
+            writer.Write(bestLength-k_lengthBase[lc], k_lengthExtra[lc]);
+            int dc = 0; while(dc < 29 && k_distBase[dc+1] <= bestDist) dc++;
+            writer.WriteHuffman(dc, 5);
+            writer.Write(bestDist-k_distBase[dc], k_distExtra[dc]);
+            advance = bestLength;
+        }
+        else
+        {
+            WriteFixedLiteral(writer, data[i]);
+        }
+
+        for(int k=0; k<advance; ++k, ++i)
+        {
+            if(i+2 >= size) continue;
+            int h = Hash(i);
+            prev[i] = head[h];
+            head[h] = i;
+        }
+    }
+
+    WriteFixedLiteral(writer, 256); // End of block.
+    writer.Flush();
+
+    uint32_t a = 1, b = 0;
+    for(uint8_t byte: data) a = (a + byte) % 65521, b = (b + a) % 65521;
+    uint32_t adler = (b << 16) | a;
+    for(int k=3; k>=0; --k) writer.bytes.push_back((uint8_t)(adler >> (k*8)));
+
+    return writer.bytes;
+}
+
+// Tries to merge a variant into a layout, each pixel's index becomes the unique pairing of its current
+// index and the variant's color, so this only succeeds if the result still fits in a single palette.
+static bool MergeVariantIntoLayout(PaletteLayout& layout, std::vector<std::vector<uint32_t>>& palettes, const std::vector<uint32_t>& pixels, int variant)
+{
+    std::map<uint64_t,uint32_t> pairs;
+    std::vector<uint32_t> indices(pixels.size());
+    for(size_t i=0; i<pixels.size(); ++i)
+    {
+        uint64_t key = (layout.members.empty()) ? pixels[i] : ((uint64_t)layout.indices[i] << 32) | pixels[i];
+        auto it = pairs.find(key);
+        if(it == pairs.end())
+        {
+            if(pairs.size() >= k_paletteSize) return false;
+            it = pairs.insert({ key, (uint32_t)pairs.size() }).first;
+        }
+        indices[i] = it->second;
+    }
+
+    // Remap the palettes of the existing members to the new indices.
+    std::vector<uint32_t> palette(k_paletteSize, 0);
+    for(int member: layout.members)
+    {
+        std::vector<uint32_t> remapped(k_paletteSize, 0);
+        for(size_t i=0; i<pixels.size(); ++i)
+            remapped[indices[i]] = palettes[member][layout.indices[i]];
+        palettes[member] = remapped;
+    }
+    for(size_t i=0; i<pixels.size(); ++i)
+        palette[indices[i]] = pixels[i];
+    palettes[variant] = palette;
+
+    layout.indices = indices;
+    layout.members.push_back(variant);
+    layout.colors = (uint32_t)pairs.size();
+
+    return true;
+}
+
+static bool CookPaletteSheet(const PaletteSheet& sheet)
+{
+    char inputName[256], outputName[256];
+    snprintf(inputName, sizeof(inputName), "assets_source/textures/%s.png", sheet.name);
+    snprintf(outputName, sizeof(outputName), "assets/textures/%s.ptex", sheet.name);
+
+    int w,h,bpp;
+    uint8_t* image = stbi_load(inputName, &w,&h,&bpp,4);
+    if(!image) return false;
+
+    int vw = (sheet.horizontal) ? w / sheet.variants : w;
+    int vh = (sheet.horizontal) ? h : h / sheet.variants;
+
+    std::vector<PaletteLayout> layouts;
+    std::vector<std::vector<uint32_t>> palettes(sheet.variants);
+    std::vector<std::vector<uint32_t>> direct;
+    std::vector<PaletteTextureVariant> variants(sheet.variants);
+
+    for(int v=0; v<sheet.variants; ++v)
+    {
+        int ox = (sheet.horizontal) ? v*vw : 0;
+        int oy = (sheet.horizontal) ? 0 : v*vh;
+
+        std::vector<uint32_t> pixels(vw*vh);
+        for(int iy=0; iy<vh; ++iy)
+            memcpy(&pixels[iy*vw], &image[((oy+iy)*w+ox)*4], vw*4);
+
+        variants[v] = { -1, -1 };
+        for(size_t i=0; i<layouts.size(); ++i)
+        {
+            if(MergeVariantIntoLayout(layouts[i], palettes, pixels, v))
+            {
+                variants[v].layout = (int32_t)i;
+                break;
+            }
+        }
+        if(variants[v].layout != -1) continue;
+
+        PaletteLayout layout = {};
+        if(MergeVariantIntoLayout(layout, palettes, pixels, v))
+        {
+            variants[v].layout = (int32_t)layouts.size();
+            layouts.push_back(layout);
+        }
+        else
+        {
+            variants[v].direct = (int32_t)direct.size();
+            palettes[v].assign(k_paletteSize, 0);
+            direct.push_back(pixels);
+        }
+    }
+
+    stbi_image_free(image);
+
+    std::vector<uint8_t> payload;
+    for(auto& layout: layouts)
+        for(uint32_t index: layout.indices)
+            payload.push_back((uint8_t)index);
+    for(auto& palette: palettes)
+        payload.insert(payload.end(), (uint8_t*)&palette[0], (uint8_t*)(&palette[0] + k_paletteSize));
+    for(auto& pixels: direct)
+        payload.insert(payload.end(), (uint8_t*)&pixels[0], (uint8_t*)(&pixels[0] + pixels.size()));
+    std::vector<uint8_t> compressed = ZlibCompress(payload);
+
+    FILE* file = fopen(outputName, "wb");
+    if(!file) return false;
+
+    PaletteTextureHeader header = { k_paletteTextureMagic, k_paletteTextureVersion, (uint32_t)vw, (uint32_t)vh,
+        (uint32_t)sheet.variants, (uint32_t)layouts.size(), (uint32_t)direct.size(), (uint32_t)payload.size() };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&variants[0], sizeof(PaletteTextureVariant), variants.size(), file);
+    fwrite(&compressed[0], 1, compressed.size(), file);
+
+    fclose(file);
+
+    return true;
+}
 
 int main(int argc, char** argv)
 {
+    for(const PaletteSheet& sheet: k_paletteSheets)
+    {
+        printf("cooking palette texture %s... ", sheet.name);
+        bool res = CookPaletteSheet(sheet);
+        printf("%s!\n", res ? "successful" : "failure");
+    }
+
     printf("packing game assets into npak... ");
     nkBool res = nk_npak_pack("binary/win32/assets.npak", "assets");
     printf("%s!\n", res ? "successful" : "failure");
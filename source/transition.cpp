@@ -20,7 +20,7 @@ static void RenderTransition(f32 dt)
         s_fadeHeight += speed * dt;
         f32 y = screenH - s_fadeHeight;
         imm::DrawRectFilled(0,y,screenW,y+s_fadeHeight, color);
-        imm::DrawTexture("transition", screenW*0.5f, y-8.0f);
+        imm::DrawTexture(s_transitionTexture, screenW*0.5f, y-8.0f);
 
         if(s_fadeHeight >= GetScreenHeight())
         {
@@ -51,14 +51,13 @@ static void RenderTransition(f32 dt)
                 StartThruster();
 
                 // Pick a random game music.
-                s32 musicVariant = RandomS32(0,3);
-                std::string musicName = "game" + std::to_string(musicVariant);
-                PlayMusic(musicName, -1);
+                s32 musicVariant = RandomS32(0,NK_ARRAY_SIZE(s_gameMusic)-1);
+                PlayMusic(s_gameMusic[musicVariant], -1);
             }
             else if(s_gameState == GameState_MainMenu)
             {
                 GoToMainMenu();
-                PlayMusic("menu", -1);
+                PlayMusic(s_menuMusic, -1);
             }
         }
     }
@@ -66,7 +65,7 @@ static void RenderTransition(f32 dt)
     {
         s_fadeHeight -= speed * dt;
         imm::DrawRectFilled(0,0,screenW,s_fadeHeight, color);
-        imm::DrawTexture("transition", screenW*0.5f, s_fadeHeight+8.0f, 1.0f,1.0f, 0.0f, imm::Flip_Vertical);
+        imm::DrawTexture(s_transitionTexture, screenW*0.5f, s_fadeHeight+8.0f, 1.0f,1.0f, 0.0f, imm::Flip_Vertical);
 
         if(s_fadeHeight <= 0.0f)
         {
@@ -4,5 +4,15 @@ static GameState s_resetTarget = GameState_Game;
 static f32 s_fadeHeight = 0.0f;
 static bool s_fadeOut = false;
 
+static AssetHandle<Texture> s_transitionTexture("transition");
+static AssetHandle<Music> s_menuMusic("menu");
+static AssetHandle<Music> s_gameMusic[]
+{
+    AssetHandle<Music>("game0"),
+    AssetHandle<Music>("game1"),
+    AssetHandle<Music>("game2"),
+    AssetHandle<Music>("game3")
+};
+
 static void ResetGame(GameState target);
 static void RenderTransition(f32 dt);
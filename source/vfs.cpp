@@ -0,0 +1,388 @@
+// Same as HashAssetName but for names that aren't null-terminated.
+static u32 HashVfsName(std::string_view name)
+{
+    u32 hash = k_assetHashSeed;
+    for(char c: name) hash = (hash ^ NK_CAST(u8, c)) * 16777619u;
+    return hash;
+}
+
+static bool IsVfsRoot(const std::string& pathName)
+{
+    return (std::find(s_vfs.roots.begin(), s_vfs.roots.end(), pathName) != s_vfs.roots.end());
+}
+
+static void ScanVfsRoot(const std::string& root, std::map<std::string,VfsEntry>& entries)
+{
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(root, error);
+    if(error) return;
+
+    for(std::filesystem::recursive_directory_iterator end; it != end; it.increment(error))
+    {
+        if(error) break;
+
+        std::string fileName = it->path().string();
+        std::replace(fileName.begin(), fileName.end(), '\\', '/');
+
+        // Roots nested inside of this one (e.g. the assets folder next to the executable) get scanned by themselves.
+        if(it->is_directory(error))
+        {
+            if(IsVfsRoot(fileName + "/")) it.disable_recursion_pending();
+            continue;
+        }
+        if(!it->is_regular_file(error)) continue;
+
+        // The roots are scanned in priority order so the first copy of a file found is the one that gets used.
+        VfsEntry& entry = entries[fileName.substr(root.length())];
+        if(entry.fileName.empty())
+            entry.fileName = fileName;
+    }
+}
+
+// Reads the NPAK's header and table, the table lives at the end of the pack after all of the file data.
+static void LoadVfsNpak(std::map<std::string,VfsEntry>& entries)
+{
+    s_vfs.npakFileName = GetExecPath() + "assets.npak";
+    s_vfs.npakFile = SDL_RWFromFile(s_vfs.npakFileName.c_str(), "rb");
+    if(!s_vfs.npakFile) return;
+
+    nkNPAKHeader header;
+    s64 fileSize = SDL_RWsize(s_vfs.npakFile);
+    bool valid = (SDL_RWread(s_vfs.npakFile, &header, sizeof(header), 1) == 1);
+    valid = valid && (header.version == NK_NPAK_FILE_VERSION) && (header.fourcc == NK_NPAK_FILE_FOURCC);
+    valid = valid && (NK_CAST(s64, header.table_offset) < fileSize);
+
+    std::vector<u8> table;
+    if(valid)
+    {
+        table.resize(NK_CAST(size_t, fileSize - header.table_offset));
+        valid = (SDL_RWseek(s_vfs.npakFile, header.table_offset, RW_SEEK_SET) >= 0);
+        valid = valid && (SDL_RWread(s_vfs.npakFile, table.data(), table.size(), 1) == 1);
+    }
+
+    // The table is parsed into its own map so a truncated or corrupt pack doesn't leave a partial index behind.
+    std::map<std::string,VfsEntry> npakEntries;
+    size_t offset = 0;
+    for(u64 i=0; valid && i<header.entries; ++i)
+    {
+        if(offset >= table.size())
+        {
+            valid = false;
+            break;
+        }
+        size_t nameLength = strnlen(NK_CAST(const char*, &table[offset]), table.size() - offset);
+        if(offset + nameLength + 1 + sizeof(u64)*2 > table.size())
+        {
+            valid = false;
+            break;
+        }
+        std::string name(NK_CAST(const char*, &table[offset]), nameLength);
+        std::replace(name.begin(), name.end(), '\\', '/');
+        offset += nameLength + 1;
+
+        VfsEntry& entry = npakEntries[name];
+        entry.inNpak = true;
+        memcpy(&entry.npakOffset, &table[offset], sizeof(u64)); offset += sizeof(u64);
+        u64 size; memcpy(&size, &table[offset], sizeof(u64)); offset += sizeof(u64);
+        entry.npakSize = NK_CAST(size_t, size);
+
+        // File data has to sit before the table.
+        if(entry.npakOffset > header.table_offset || size > header.table_offset - entry.npakOffset)
+            valid = false;
+    }
+
+    if(!valid)
+    {
+        printf("Failed to load NPAK assets, it is invalid!\n");
+        SDL_RWclose(s_vfs.npakFile);
+        s_vfs.npakFile = NULL;
+        return;
+    }
+
+    entries.insert(npakEntries.begin(), npakEntries.end());
+
+    printf("Successfully loaded NPAK assets!\n");
+}
+
+static void InitVfs()
+{
+    std::map<std::string,VfsEntry> entries;
+
+    // Attempt to load the NPAK, if not then it doesn't matter.
+    #if !defined(__EMSCRIPTEN__)
+    LoadVfsNpak(entries);
+    #endif // __EMSCRIPTEN__
+
+    // The executable's location is the highest priority location for assets.
+    s_vfs.roots.push_back(GetExecPath());
+    s_vfs.roots.push_back(GetExecPath() + "assets/");
+
+    // If there's other asset locations add them with descending priority.
+    std::ifstream file("asset_paths.txt", std::ios::in);
+    if(file.is_open())
+    {
+        std::string path;
+        while(std::getline(file, path))
+        {
+            s_vfs.roots.push_back(GetExecPath() + ValidatePath(path));
+        }
+    }
+
+    for(auto& root: s_vfs.roots)
+        ScanVfsRoot(root, entries);
+
+    s_vfs.entries.reserve(entries.size());
+    for(auto& [name,entry]: entries)
+    {
+        entry.name = name;
+        s_vfs.lookup[HashVfsName(name)] = NK_CAST(u32, s_vfs.entries.size());
+        s_vfs.entries.push_back(std::move(entry));
+    }
+
+    printf("Indexed %zu asset files from %zu locations!\n", s_vfs.entries.size(), s_vfs.roots.size() + (s_vfs.npakFile ? 1 : 0));
+}
+
+static void QuitVfs()
+{
+    s_vfs.lookup.clear();
+    s_vfs.entries.clear();
+    s_vfs.roots.clear();
+
+    if(s_vfs.npakFile)
+    {
+        SDL_RWclose(s_vfs.npakFile);
+        s_vfs.npakFile = NULL;
+    }
+}
+
+static const VfsEntry* FindVfsFile(std::string_view name)
+{
+    auto it = s_vfs.lookup.find(HashVfsName(name));
+    if(it == s_vfs.lookup.end()) return NULL;
+    const VfsEntry& entry = s_vfs.entries[it->second];
+    return ((entry.name == name) ? &entry : NULL); // Guard against hash collisions.
+}
+
+static void ListVfsFiles(std::string_view path, std::string_view ext, std::vector<const VfsEntry*>& files)
+{
+    auto it = std::lower_bound(s_vfs.entries.begin(), s_vfs.entries.end(), path,
+        [](const VfsEntry& entry, std::string_view path) { return (entry.name < path); });
+    for(; it != s_vfs.entries.end(); ++it)
+    {
+        std::string_view name = it->name;
+        if(name.substr(0, path.length()) != path) break;
+        if(name.length() > ext.length() && name.substr(name.length()-ext.length()) == ext)
+            files.push_back(&(*it));
+    }
+}
+
+static bool ReadVfsFile(const VfsEntry& entry, VfsFile& file)
+{
+    if(entry.inNpak && s_vfs.npakFile)
+    {
+        file.buffer.resize(entry.npakSize);
+        file.data = file.buffer.data();
+        file.size = file.buffer.size();
+        if(!entry.npakSize) return true;
+        if(SDL_RWseek(s_vfs.npakFile, entry.npakOffset, RW_SEEK_SET) >= 0 &&
+           SDL_RWread(s_vfs.npakFile, file.buffer.data(), entry.npakSize, 1) == 1)
+        {
+            return true;
+        }
+        printf("Failed to read %s from the NPAK!\n", entry.name.c_str());
+    }
+    if(entry.fileName.empty()) return false;
+    file.buffer = ReadBinaryFile(entry.fileName);
+    file.data = file.buffer.data();
+    file.size = file.buffer.size();
+    return !file.buffer.empty();
+}
+
+//
+// Streaming
+//
+
+#if !defined(__EMSCRIPTEN__)
+static bool ReadVfsStreamFile(VfsStream* stream, u64 offset, void* data, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(stream->fileMutex);
+    if(SDL_RWseek(stream->file, stream->base + offset, RW_SEEK_SET) < 0) return false;
+    return (SDL_RWread(stream->file, data, bytes, 1) == 1);
+}
+
+static void VfsStreamReadAhead(VfsStream* stream)
+{
+    std::vector<u8> chunk(VfsStream::k_chunkSize);
+
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    while(!stream->quit)
+    {
+        // Drop whatever has already been consumed to make room for more.
+        if(stream->position > stream->windowStart && stream->position <= stream->windowStart + stream->windowFill)
+        {
+            size_t consumed = NK_CAST(size_t, stream->position - stream->windowStart);
+            memmove(stream->window.data(), stream->window.data() + consumed, stream->windowFill - consumed);
+            stream->windowStart += consumed;
+            stream->windowFill -= consumed;
+        }
+
+        u64 next = stream->windowStart + stream->windowFill;
+        if(stream->window.size() - stream->windowFill < VfsStream::k_chunkSize || next >= stream->size)
+        {
+            stream->wake.wait(lock);
+            continue;
+        }
+
+        // Don't hold the lock whilst hitting the disk, the reader only needs it for the window.
+        size_t bytes = NK_CAST(size_t, std::min<u64>(VfsStream::k_chunkSize, stream->size - next));
+        u32 generation = stream->generation;
+        lock.unlock();
+        bool read = ReadVfsStreamFile(stream, next, chunk.data(), bytes);
+        lock.lock();
+
+        if(generation != stream->generation) continue;
+        if(!read)
+        {
+            stream->wake.wait(lock); // The reader will hit the error itself when it gets here.
+            continue;
+        }
+        memcpy(stream->window.data() + stream->windowFill, chunk.data(), bytes);
+        stream->windowFill += bytes;
+    }
+}
+
+static VfsStream* GetVfsStream(SDL_RWops* rwops)
+{
+    return NK_CAST(VfsStream*, rwops->hidden.unknown.data1);
+}
+
+static Sint64 SDLCALL VfsStreamSize(SDL_RWops* rwops)
+{
+    return NK_CAST(Sint64, GetVfsStream(rwops)->size);
+}
+
+static Sint64 SDLCALL VfsStreamSeek(SDL_RWops* rwops, Sint64 offset, int whence)
+{
+    VfsStream* stream = GetVfsStream(rwops);
+    std::lock_guard<std::mutex> lock(stream->mutex);
+
+    Sint64 position;
+    switch(whence)
+    {
+        case RW_SEEK_SET: position = offset; break;
+        case RW_SEEK_CUR: position = NK_CAST(Sint64, stream->position) + offset; break;
+        case RW_SEEK_END: position = NK_CAST(Sint64, stream->size) + offset; break;
+        default: return SDL_SetError("Unknown seek mode for VFS stream!");
+    }
+    if(position < 0)
+        return SDL_SetError("Attempted to seek before the start of a VFS stream!");
+
+    stream->position = std::min(NK_CAST(u64, position), stream->size);
+    return NK_CAST(Sint64, stream->position);
+}
+
+static size_t SDLCALL VfsStreamRead(SDL_RWops* rwops, void* ptr, size_t size, size_t maxnum)
+{
+    VfsStream* stream = GetVfsStream(rwops);
+    if(!size || !maxnum) return 0;
+
+    std::unique_lock<std::mutex> lock(stream->mutex);
+
+    size_t count = NK_CAST(size_t, std::min<u64>(maxnum, (stream->size - stream->position) / size));
+    size_t bytes = count * size;
+    u8* data = NK_CAST(u8*, ptr);
+
+    // Take as much as we can from the read-ahead window.
+    if(stream->position >= stream->windowStart && stream->position < stream->windowStart + stream->windowFill)
+    {
+        size_t offset = NK_CAST(size_t, stream->position - stream->windowStart);
+        size_t available = std::min(bytes, stream->windowFill - offset);
+        memcpy(data, stream->window.data() + offset, available);
+        stream->position += available;
+        data += available;
+        bytes -= available;
+    }
+
+    // Anything else has to come straight from the file, the window then restarts from where this read ends.
+    bool failed = false;
+    if(bytes)
+    {
+        u64 position = stream->position;
+        stream->generation++;
+        stream->position += bytes;
+        stream->windowStart = stream->position;
+        stream->windowFill = 0;
+        lock.unlock();
+        failed = !ReadVfsStreamFile(stream, position, data, bytes);
+        lock.lock();
+        if(failed)
+        {
+            stream->position = position;
+            SDL_SetError("Failed to read from VFS stream!");
+        }
+    }
+
+    stream->wake.notify_one();
+
+    return (failed) ? (count * size - bytes) / size : count;
+}
+
+static size_t SDLCALL VfsStreamWrite(SDL_RWops*, const void*, size_t, size_t)
+{
+    SDL_SetError("VFS streams are read-only!");
+    return 0;
+}
+
+static int SDLCALL VfsStreamClose(SDL_RWops* rwops)
+{
+    VfsStream* stream = GetVfsStream(rwops);
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->quit = true;
+    }
+    stream->wake.notify_one();
+    stream->thread.join();
+
+    SDL_RWclose(stream->file);
+    Deallocate(stream);
+    SDL_FreeRW(rwops);
+    return 0;
+}
+#endif // __EMSCRIPTEN__
+
+static SDL_RWops* OpenVfsStream(const VfsEntry& entry)
+{
+    #if !defined(__EMSCRIPTEN__)
+    if(entry.inNpak && s_vfs.npakFile)
+    {
+        SDL_RWops* file = SDL_RWFromFile(s_vfs.npakFileName.c_str(), "rb");
+        SDL_RWops* rwops = (file) ? SDL_AllocRW() : NULL;
+        if(rwops)
+        {
+            VfsStream* stream = Allocate<VfsStream>(MEM_SYSTEM);
+            if(!stream) FatalError("Failed to allocate VFS stream!\n");
+            stream->file = file;
+            stream->base = entry.npakOffset;
+            stream->size = entry.npakSize;
+            stream->position = 0;
+            stream->window.resize(VfsStream::k_windowSize);
+            stream->thread = std::thread(VfsStreamReadAhead, stream);
+
+            rwops->size = VfsStreamSize;
+            rwops->seek = VfsStreamSeek;
+            rwops->read = VfsStreamRead;
+            rwops->write = VfsStreamWrite;
+            rwops->close = VfsStreamClose;
+            rwops->type = SDL_RWOPS_UNKNOWN;
+            rwops->hidden.unknown.data1 = stream;
+            return rwops;
+        }
+        printf("Failed to open stream for %s from the NPAK! (%s)\n", entry.name.c_str(), SDL_GetError());
+        if(file) SDL_RWclose(file);
+    }
+    #endif // __EMSCRIPTEN__
+
+    // Files on disk can just be read as we go.
+    if(entry.fileName.empty()) return NULL;
+    return SDL_RWFromFile(entry.fileName.c_str(), "rb");
+}
@@ -0,0 +1,69 @@
+// Virtual file system over everywhere assets can come from: the NPAK and the asset paths (the executable's
+// location and anything listed in asset_paths.txt). Everything gets scanned once at startup into a single
+// index keyed by the hashed virtual name (e.g. "textures/asteroid.png"), so lookups, enumeration and reads
+// never need to go probing the disk. Files added after startup won't be seen until the next run.
+//
+// Only the NPAK's table is kept in memory, file data is read from the pack on demand so that the assets
+// don't end up costing memory twice (once in the pack and once loaded) and can be evicted and reloaded.
+struct VfsEntry
+{
+    std::string name;            // Virtual name, relative to the root of the asset paths.
+    std::string fileName;        // Highest priority copy on disk, empty if the file only lives in the NPAK.
+    bool        inNpak = false;  // Whether there's a copy in the NPAK, which takes priority over the disk.
+    u64         npakOffset = 0;
+    size_t      npakSize = 0;
+};
+
+// The contents of a file, as read into the buffer.
+struct VfsFile
+{
+    const u8*       data = NULL;
+    size_t          size = 0;
+    std::vector<u8> buffer;
+};
+
+// Read-only view of an entry's region of the NPAK, for things that decode as they go (i.e. music) so that
+// only the part being decoded needs to be in memory. A background thread keeps a window of the file ahead
+// of the read position filled, so in the common case the audio thread never has to wait on the disk, a read
+// outside of the window (e.g. the decoder seeking back to loop) reads directly and restarts the window.
+#if !defined(__EMSCRIPTEN__)
+struct VfsStream
+{
+    static constexpr size_t k_windowSize = 64*1024;
+    static constexpr size_t k_chunkSize = 16*1024;
+
+    SDL_RWops*              file; // Our own handle so the read-ahead doesn't fight over the shared one's position.
+    std::mutex              fileMutex;
+    u64                     base;
+    u64                     size;
+    u64                     position; // Relative to the start of the entry.
+
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::thread             thread;
+    std::vector<u8>         window;
+    u64                     windowStart = 0;
+    size_t                  windowFill = 0;
+    u32                     generation = 0; // Bumped whenever the window restarts, so stale read-ahead gets thrown away.
+    bool                    quit = false;
+};
+#endif // __EMSCRIPTEN__
+
+struct Vfs
+{
+    std::string                  npakFileName;
+    SDL_RWops*                   npakFile; // Kept open for the session, NULL if there's no NPAK.
+    std::vector<std::string>     roots;   // Asset paths in descending priority.
+    std::vector<VfsEntry>        entries; // Sorted by name so enumerating a directory is a contiguous range.
+    std::unordered_map<u32,u32>  lookup;  // HashAssetName of the name -> index into entries.
+};
+
+static Vfs s_vfs;
+
+static void InitVfs();
+static void QuitVfs();
+
+static const VfsEntry* FindVfsFile(std::string_view name); // NULL if it doesn't exist in any of the sources.
+static void            ListVfsFiles(std::string_view path, std::string_view ext, std::vector<const VfsEntry*>& files); // Recursive.
+static bool            ReadVfsFile(const VfsEntry& entry, VfsFile& file);
+static SDL_RWops*      OpenVfsStream(const VfsEntry& entry); // For incremental reads, close with SDL_RWclose. NULL on failure.